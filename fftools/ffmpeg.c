@@ -126,6 +126,11 @@ typedef struct BenchmarkTimeStamps {
     int64_t sys_usec;
 } BenchmarkTimeStamps;
 
+typedef struct ProfileTimeStamps {
+    int64_t wall_usec;
+    int64_t cpu_usec;
+} ProfileTimeStamps;
+
 static void do_video_stats(OutputStream *ost, int frame_size);
 static BenchmarkTimeStamps get_benchmark_time_stamps(void);
 static int64_t getmaxrss(void);
@@ -166,6 +171,7 @@ static int restore_tty;
 
 #if HAVE_THREADS
 static void free_input_threads(void);
+static void free_output_threads(void);
 #endif
 
 /* sub2video hack:
@@ -530,6 +536,10 @@ static void ffmpeg_cleanup(int ret)
 
     av_freep(&subtitle_out);
 
+#if HAVE_THREADS
+    free_output_threads();
+#endif
+
     /* close files */
     for (i = 0; i < nb_output_files; i++) {
         OutputFile *of = output_files[i];
@@ -677,6 +687,23 @@ static void update_benchmark(const char *fmt, ...)
     }
 }
 
+static void profile_start(ProfileTimeStamps *t)
+{
+    if (stats_profile >= 0) {
+        t->wall_usec = av_gettime_relative();
+        t->cpu_usec  = av_gettime_thread_cpu();
+    }
+}
+
+static void profile_stop(StageProfile *p, const ProfileTimeStamps *t, int count)
+{
+    if (stats_profile >= 0) {
+        atomic_fetch_add(&p->wall_time, av_gettime_relative() - t->wall_usec);
+        atomic_fetch_add(&p->cpu_time,  av_gettime_thread_cpu() - t->cpu_usec);
+        atomic_fetch_add(&p->count,     count);
+    }
+}
+
 static void close_all_output_streams(OutputStream *ost, OSTFinished this_stream, OSTFinished others)
 {
     int i;
@@ -686,10 +713,171 @@ static void close_all_output_streams(OutputStream *ost, OSTFinished this_stream,
     }
 }
 
+#if HAVE_THREADS
+/* Make the muxer state read by the main thread available to it. */
+static void publish_mux_state(OutputFile *of)
+{
+    int i;
+
+    for (i = 0; i < of->ctx->nb_streams; i++) {
+        OutputStream *ost = output_streams[of->ost_index + i];
+        atomic_store(&ost->mux_end_pts, av_stream_get_end_pts(ost->st));
+        atomic_store(&ost->mux_cur_dts, ost->st->cur_dts);
+        atomic_store(&ost->mux_nb_frames, ost->st->nb_frames);
+    }
+    if (of->ctx->pb)
+        atomic_store(&of->mux_bytes, avio_tell(of->ctx->pb));
+}
+
+static void *mux_thread(void *arg)
+{
+    OutputFile *of = arg;
+    int ret = 0;
+
+    while (1) {
+        ProfileTimeStamps pt;
+        AVPacket pkt;
+        ret = av_thread_message_queue_recv(of->mux_thread_queue, &pkt, 0);
+        if (ret < 0)
+            break;
+
+        profile_start(&pt);
+        ret = av_interleaved_write_frame(of->ctx, &pkt);
+        profile_stop(&of->mux_profile, &pt, 1);
+        av_packet_unref(&pkt);
+        publish_mux_state(of);
+        if (ret < 0) {
+            print_error("av_interleaved_write_frame()", ret);
+            av_thread_message_queue_set_err_send(of->mux_thread_queue, ret);
+            break;
+        }
+    }
+
+    return NULL;
+}
+
+static void free_output_threads(void)
+{
+    int i;
+
+    for (i = 0; i < nb_output_files; i++) {
+        OutputFile *of = output_files[i];
+        AVPacket pkt;
+
+        if (!of || !of->mux_thread_queue)
+            continue;
+        /* let the thread write out what is already queued, then stop */
+        av_thread_message_queue_set_err_recv(of->mux_thread_queue, AVERROR_EOF);
+        pthread_join(of->mux_thread, NULL);
+        while (av_thread_message_queue_recv(of->mux_thread_queue, &pkt,
+                                            AV_THREAD_MESSAGE_NONBLOCK) >= 0)
+            av_packet_unref(&pkt);
+        av_thread_message_queue_free(&of->mux_thread_queue);
+    }
+}
+
+static int init_output_thread(OutputFile *of)
+{
+    int i, ret;
+
+    /* -fs checks the exact write position after every packet */
+    if (of->limit_filesize != UINT64_MAX)
+        return 0;
+
+    ret = av_thread_message_queue_alloc(&of->mux_thread_queue,
+                                        of->thread_queue_size, sizeof(AVPacket));
+    if (ret < 0)
+        return ret;
+
+    atomic_init(&of->mux_bytes, of->ctx->pb ? avio_tell(of->ctx->pb) : 0);
+    for (i = 0; i < of->ctx->nb_streams; i++) {
+        OutputStream *ost = output_streams[of->ost_index + i];
+        atomic_init(&ost->mux_end_pts, av_stream_get_end_pts(ost->st));
+        atomic_init(&ost->mux_cur_dts, ost->st->cur_dts);
+        atomic_init(&ost->mux_nb_frames, ost->st->nb_frames);
+    }
+    if ((ret = pthread_create(&of->mux_thread, NULL, mux_thread, of))) {
+        av_log(NULL, AV_LOG_ERROR, "pthread_create failed: %s. Try to increase `ulimit -v` or decrease `ulimit -s`.\n", strerror(ret));
+        av_thread_message_queue_free(&of->mux_thread_queue);
+        return AVERROR(ret);
+    }
+    return 0;
+}
+
+static int write_packet_mt(OutputFile *of, AVPacket *pkt)
+{
+    int ret;
+
+    /* the packet is handed over to the muxing thread, make sure its data
+     * outlives the caller's buffers */
+    if (!pkt->buf) {
+        AVPacket tmp_pkt;
+        ret = av_packet_ref(&tmp_pkt, pkt);
+        if (ret < 0)
+            return ret;
+        av_packet_unref(pkt);
+        *pkt = tmp_pkt;
+    }
+    ret = av_thread_message_queue_send(of->mux_thread_queue, pkt, 0);
+    if (ret < 0)
+        return ret;
+    /* like av_interleaved_write_frame(), take ownership of the packet */
+    av_init_packet(pkt);
+    pkt->data = NULL;
+    pkt->size = 0;
+    return 0;
+}
+#endif
+
+/* Current write position of an output file. */
+static int64_t output_file_tell(OutputFile *of)
+{
+#if HAVE_THREADS
+    /* the AVIOContext belongs to the muxing thread while it runs */
+    if (of->mux_thread_queue)
+        return atomic_load(&of->mux_bytes);
+#endif
+    return avio_tell(of->ctx->pb);
+}
+
+/* End pts of an output stream, see av_stream_get_end_pts(). */
+static int64_t output_stream_end_pts(OutputStream *ost)
+{
+#if HAVE_THREADS
+    if (output_files[ost->file_index]->mux_thread_queue)
+        return atomic_load(&ost->mux_end_pts);
+#endif
+    return av_stream_get_end_pts(ost->st);
+}
+
+/* Current dts of an output stream, see AVStream.cur_dts. While a muxing thread
+ * runs, this is the dts of the last packet queued for it, so that the choice
+ * of the next output to feed does not depend on how far the thread got. */
+static int64_t output_stream_cur_dts(OutputStream *ost)
+{
+#if HAVE_THREADS
+    if (output_files[ost->file_index]->mux_thread_queue)
+        return ost->last_mux_dts != AV_NOPTS_VALUE ? ost->last_mux_dts :
+               atomic_load(&ost->mux_cur_dts);
+#endif
+    return ost->st->cur_dts;
+}
+
+/* Number of frames written to an output stream by its muxer. */
+static int output_stream_nb_frames(OutputStream *ost)
+{
+#if HAVE_THREADS
+    if (output_files[ost->file_index]->mux_thread_queue)
+        return atomic_load(&ost->mux_nb_frames);
+#endif
+    return ost->st->nb_frames;
+}
+
 static void write_packet(OutputFile *of, AVPacket *pkt, OutputStream *ost, int unqueue)
 {
     AVFormatContext *s = of->ctx;
     AVStream *st = ost->st;
+    ProfileTimeStamps pt;
     int ret;
 
     /*
@@ -812,7 +1000,22 @@ static void write_packet(OutputFile *of, AVPacket *pkt, OutputStream *ost, int u
               );
     }
 
+#if HAVE_THREADS
+    if (of->mux_thread_queue) {
+        ret = write_packet_mt(of, pkt);
+        if (ret >= 0)
+            return;
+        /* the muxing thread has already reported the failure */
+        main_return_code = 1;
+        close_all_output_streams(ost, MUXER_FINISHED | ENCODER_FINISHED, ENCODER_FINISHED);
+        av_packet_unref(pkt);
+        return;
+    }
+#endif
+
+    profile_start(&pt);
     ret = av_interleaved_write_frame(s, pkt);
+    profile_stop(&of->mux_profile, &pt, 1);
     if (ret < 0) {
         print_error("av_interleaved_write_frame()", ret);
         main_return_code = 1;
@@ -911,6 +1114,7 @@ static void do_audio_out(OutputFile *of, OutputStream *ost,
                          AVFrame *frame)
 {
     AVCodecContext *enc = ost->enc_ctx;
+    ProfileTimeStamps pt;
     AVPacket pkt;
     int ret;
 
@@ -936,12 +1140,16 @@ static void do_audio_out(OutputFile *of, OutputStream *ost,
                enc->time_base.num, enc->time_base.den);
     }
 
+    profile_start(&pt);
     ret = avcodec_send_frame(enc, frame);
+    profile_stop(&ost->enc_profile, &pt, 1);
     if (ret < 0)
         goto error;
 
     while (1) {
+        profile_start(&pt);
         ret = avcodec_receive_packet(enc, &pkt);
+        profile_stop(&ost->enc_profile, &pt, 0);
         if (ret == AVERROR(EAGAIN))
             break;
         if (ret < 0)
@@ -1056,6 +1264,7 @@ static void do_video_out(OutputFile *of,
                          double sync_ipts)
 {
     int ret, format_video_sync;
+    ProfileTimeStamps pt;
     AVPacket pkt;
     AVCodecContext *enc = ost->enc_ctx;
     AVCodecParameters *mux_par = ost->st->codecpar;
@@ -1285,12 +1494,16 @@ static void do_video_out(OutputFile *of,
 
         ost->frames_encoded++;
 
+        profile_start(&pt);
         ret = avcodec_send_frame(enc, in_picture);
+        profile_stop(&ost->enc_profile, &pt, 1);
         if (ret < 0)
             goto error;
 
         while (1) {
+            profile_start(&pt);
             ret = avcodec_receive_packet(enc, &pkt);
+            profile_stop(&ost->enc_profile, &pt, 0);
             update_benchmark("encode_video %d.%d", ost->file_index, ost->index);
             if (ret == AVERROR(EAGAIN))
                 break;
@@ -1373,7 +1586,7 @@ static void do_video_stats(OutputStream *ost, int frame_size)
 
     enc = ost->enc_ctx;
     if (enc->codec_type == AVMEDIA_TYPE_VIDEO) {
-        frame_number = ost->st->nb_frames;
+        frame_number = output_stream_nb_frames(ost);
         if (vstats_version <= 1) {
             fprintf(vstats_file, "frame= %5d q= %2.1f ", frame_number,
                     ost->quality / (float)FF_QP2LAMBDA);
@@ -1387,7 +1600,7 @@ static void do_video_stats(OutputStream *ost, int frame_size)
 
         fprintf(vstats_file,"f_size= %6d ", frame_size);
         /* compute pts value */
-        ti1 = av_stream_get_end_pts(ost->st) * av_q2d(ost->st->time_base);
+        ti1 = output_stream_end_pts(ost) * av_q2d(ost->st->time_base);
         if (ti1 < 0.01)
             ti1 = 0.01;
 
@@ -1643,6 +1856,84 @@ static void print_final_stats(int64_t total_size)
     }
 }
 
+static void print_stage_profile(const char *stage, const char *name,
+                                const char *unit, StageProfile *p)
+{
+    av_log(NULL, AV_LOG_INFO, "  %-8s %-32s %s:%8"PRId64" wall:%10.1fms cpu:%10.1fms\n",
+           stage, name, unit, (int64_t)atomic_load(&p->count),
+           atomic_load(&p->wall_time) / 1000.0, atomic_load(&p->cpu_time) / 1000.0);
+}
+
+static void print_profile(int is_last_report, int64_t timer_start, int64_t cur_time)
+{
+    static int64_t last_time = -1;
+    char name[128];
+    int i, j;
+
+    if (stats_profile < 0)
+        return;
+
+    if (!is_last_report) {
+        if (!stats_profile)
+            return;
+        if (last_time == -1) {
+            last_time = cur_time;
+            return;
+        }
+        if (cur_time - last_time < stats_profile * 1000000)
+            return;
+        last_time = cur_time;
+    }
+
+    av_log(NULL, AV_LOG_INFO, "%s profile after %.1fs:\n",
+           is_last_report ? "Final" : "Intermediate",
+           (cur_time - timer_start) / 1000000.0);
+
+    for (i = 0; i < nb_input_streams; i++) {
+        InputStream *ist = input_streams[i];
+        if (!ist->decoding_needed)
+            continue;
+        snprintf(name, sizeof(name), "#%d:%d (%s)", ist->file_index,
+                 ist->st->index, ist->dec->name);
+        print_stage_profile("decoder", name, "frames", &ist->dec_profile);
+    }
+
+    for (i = 0; i < nb_filtergraphs; i++) {
+        AVFilterGraph *graph = filtergraphs[i]->graph;
+        if (!graph)
+            continue;
+        for (j = 0; j < graph->nb_filters; j++) {
+            AVFilterContext *filter = graph->filters[j];
+            const AVFilterProfile *p = avfilter_get_profile(filter);
+            if (!p)
+                continue;
+            snprintf(name, sizeof(name), "%d:%s (%s)", i, filter->name,
+                     filter->filter->name);
+            av_log(NULL, AV_LOG_INFO, "  %-8s %-32s frames:%8"PRIu64"/%-8"PRIu64
+                   " wall:%10.1fms cpu:%10.1fms activations:%"PRIu64
+                   " queued:%"PRIu64" (max %"PRIu64")\n",
+                   "filter", name, p->frames_in, p->frames_out,
+                   p->wall_time / 1000.0, p->cpu_time / 1000.0,
+                   p->activations, p->queued, p->max_queued);
+        }
+    }
+
+    for (i = 0; i < nb_output_streams; i++) {
+        OutputStream *ost = output_streams[i];
+        if (!ost->encoding_needed)
+            continue;
+        snprintf(name, sizeof(name), "#%d:%d (%s)", ost->file_index,
+                 ost->index, ost->enc->name);
+        print_stage_profile("encoder", name, "frames", &ost->enc_profile);
+    }
+
+    for (i = 0; i < nb_output_files; i++) {
+        OutputFile *of = output_files[i];
+        snprintf(name, sizeof(name), "#%d (%s)", i, of->ctx->oformat->name);
+        print_stage_profile("muxer", name, "packets", &of->mux_profile);
+    }
+}
+
 static void print_report(int is_last_report, int64_t timer_start, int64_t cur_time)
 {
     AVBPrint buf, buf_script;
@@ -1679,15 +1970,21 @@ static void print_report(int is_last_report, int64_t timer_start, int64_t cur_ti
 
     oc = output_files[0]->ctx;
 
+#if HAVE_THREADS
+    if (output_files[0]->mux_thread_queue)
+        total_size = output_file_tell(output_files[0]);
+    else
+#endif
     total_size = avio_size(oc->pb);
     if (total_size <= 0) // FIXME improve avio_size() so it works with non seekable output too
-        total_size = avio_tell(oc->pb);
+        total_size = output_file_tell(output_files[0]);
 
     vid = 0;
     av_bprint_init(&buf, 0, AV_BPRINT_SIZE_AUTOMATIC);
     av_bprint_init(&buf_script, 0, 1);
     for (i = 0; i < nb_output_streams; i++) {
         float q = -1;
+        int64_t end_pts;
         ost = output_streams[i];
         enc = ost->enc_ctx;
         if (!ost->stream_copy)
@@ -1752,9 +2049,9 @@ static void print_report(int is_last_report, int64_t timer_start, int64_t cur_ti
             vid = 1;
         }
         /* compute min output value */
-        if (av_stream_get_end_pts(ost->st) != AV_NOPTS_VALUE)
-            pts = FFMAX(pts, av_rescale_q(av_stream_get_end_pts(ost->st),
-                                          ost->st->time_base, AV_TIME_BASE_Q));
+        end_pts = output_stream_end_pts(ost);
+        if (end_pts != AV_NOPTS_VALUE)
+            pts = FFMAX(pts, av_rescale_q(end_pts, ost->st->time_base, AV_TIME_BASE_Q));
         if (is_last_report)
             nb_frames_drop += ost->last_dropped;
     }
@@ -1855,6 +2152,7 @@ static void ifilter_parameters_from_codecpar(InputFilter *ifilter, AVCodecParame
 
 static void flush_encoders(void)
 {
+    ProfileTimeStamps pt;
     int i, ret;
 
     for (i = 0; i < nb_output_streams; i++) {
@@ -1930,6 +2228,7 @@ static void flush_encoders(void)
                 pkt.size = 0;
 
                 update_benchmark(NULL);
+                profile_start(&pt);
 
                 while ((ret = avcodec_receive_packet(enc, &pkt)) == AVERROR(EAGAIN)) {
                     ret = avcodec_send_frame(enc, NULL);
@@ -1941,6 +2240,7 @@ static void flush_encoders(void)
                     }
                 }
 
+                profile_stop(&ost->enc_profile, &pt, 0);
                 update_benchmark("flush_%s %d.%d", desc, ost->file_index, ost->index);
                 if (ret < 0 && ret != AVERROR_EOF) {
                     av_log(NULL, AV_LOG_FATAL, "%s encoding failed: %s\n",
@@ -2278,6 +2578,7 @@ static int decode_audio(InputStream *ist, AVPacket *pkt, int *got_output,
 {
     AVFrame *decoded_frame;
     AVCodecContext *avctx = ist->dec_ctx;
+    ProfileTimeStamps pt;
     int ret, err = 0;
     AVRational decoded_frame_tb;
 
@@ -2288,7 +2589,9 @@ static int decode_audio(InputStream *ist, AVPacket *pkt, int *got_output,
     decoded_frame = ist->decoded_frame;
 
     update_benchmark(NULL);
+    profile_start(&pt);
     ret = decode(avctx, decoded_frame, got_output, pkt);
+    profile_stop(&ist->dec_profile, &pt, ret >= 0 && *got_output);
     update_benchmark("decode_audio %d.%d", ist->file_index, ist->st->index);
     if (ret < 0)
         *decode_failed = 1;
@@ -2341,6 +2644,7 @@ static int decode_video(InputStream *ist, AVPacket *pkt, int *got_output, int64_
                         int *decode_failed)
 {
     AVFrame *decoded_frame;
+    ProfileTimeStamps pt;
     int i, ret = 0, err = 0;
     int64_t best_effort_timestamp;
     int64_t dts = AV_NOPTS_VALUE;
@@ -2375,7 +2679,9 @@ static int decode_video(InputStream *ist, AVPacket *pkt, int *got_output, int64_
     }
 
     update_benchmark(NULL);
+    profile_start(&pt);
     ret = decode(ist->dec_ctx, decoded_frame, got_output, pkt ? &avpkt : NULL);
+    profile_stop(&ist->dec_profile, &pt, ret >= 0 && *got_output);
     update_benchmark("decode_video %d.%d", ist->file_index, ist->st->index);
     if (ret < 0)
         *decode_failed = 1;
@@ -2987,6 +3293,11 @@ static int check_init_output_file(OutputFile *of, int file_index)
     if (sdp_filename || want_sdp)
         print_sdp();
 
+#if HAVE_THREADS
+    if ((ret = init_output_thread(of)) < 0)
+        return ret;
+#endif
+
     /* flush the muxing queues */
     for (i = 0; i < of->ctx->nb_streams; i++) {
         OutputStream *ost = output_streams[of->ost_index + i];
@@ -3811,7 +4122,7 @@ static int need_output(void)
         AVFormatContext *os  = output_files[ost->file_index]->ctx;
 
         if (ost->finished ||
-            (os->pb && avio_tell(os->pb) >= of->limit_filesize))
+            (os->pb && output_file_tell(of) >= of->limit_filesize))
             continue;
         if (ost->frame_number >= ost->max_frames) {
             int j;
@@ -3839,10 +4150,11 @@ static OutputStream *choose_output(void)
 
     for (i = 0; i < nb_output_streams; i++) {
         OutputStream *ost = output_streams[i];
-        int64_t opts = ost->st->cur_dts == AV_NOPTS_VALUE ? INT64_MIN :
-                       av_rescale_q(ost->st->cur_dts, ost->st->time_base,
+        int64_t cur_dts = output_stream_cur_dts(ost);
+        int64_t opts = cur_dts == AV_NOPTS_VALUE ? INT64_MIN :
+                       av_rescale_q(cur_dts, ost->st->time_base,
                                     AV_TIME_BASE_Q);
-        if (ost->st->cur_dts == AV_NOPTS_VALUE)
+        if (cur_dts == AV_NOPTS_VALUE)
             av_log(NULL, AV_LOG_DEBUG, "cur_dts is invalid (this is harmless if it occurs once at the start per stream)\n");
 
         if (!ost->initialized && !ost->inputs_done)
@@ -4636,6 +4948,7 @@ static int transcode(void)
 
         /* dump report by using the output first video and audio streams */
         print_report(0, timer_start, cur_time);
+        print_profile(0, timer_start, cur_time);
     }
 #if HAVE_THREADS
     free_input_threads();
@@ -4652,6 +4965,10 @@ static int transcode(void)
 
     term_exit();
 
+#if HAVE_THREADS
+    free_output_threads();
+#endif
+
     /* write the trailer if needed and close file */
     for (i = 0; i < nb_output_files; i++) {
         os = output_files[i]->ctx;
@@ -4671,6 +4988,7 @@ static int transcode(void)
 
     /* dump report by using the first video and audio streams */
     print_report(1, timer_start, av_gettime_relative());
+    print_profile(1, timer_start, av_gettime_relative());
 
     /* close each encoder */
     for (i = 0; i < nb_output_streams; i++) {
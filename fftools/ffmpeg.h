@@ -24,6 +24,7 @@
 #include <stdint.h>
 #include <stdio.h>
 #include <signal.h>
+#include <stdatomic.h>
 
 #include "cmdutils.h"
 
@@ -292,6 +293,13 @@ typedef struct FilterGraph {
     int         nb_outputs;
 } FilterGraph;
 
+/* time spent in a stage of the pipeline, for -stats_profile */
+typedef struct StageProfile {
+    atomic_int_least64_t count;     /* frames or packets processed */
+    atomic_int_least64_t wall_time; /* in microseconds */
+    atomic_int_least64_t cpu_time;  /* of the calling thread, in microseconds */
+} StageProfile;
+
 typedef struct InputStream {
     int file_index;
     AVStream *st;
@@ -388,6 +396,8 @@ typedef struct InputStream {
     int nb_dts_buffer;
 
     int got_output;
+
+    StageProfile dec_profile;
 } InputStream;
 
 typedef struct InputFile {
@@ -548,6 +558,15 @@ typedef struct OutputStream {
 
     /* frame encode sum of squared error values */
     int64_t error[4];
+
+    StageProfile enc_profile;
+
+#if HAVE_THREADS
+    /* muxer state published by the muxing thread of the file, if any */
+    atomic_int_least64_t mux_end_pts;
+    atomic_int_least64_t mux_cur_dts;
+    atomic_int mux_nb_frames;
+#endif
 } OutputStream;
 
 typedef struct OutputFile {
@@ -561,6 +580,15 @@ typedef struct OutputFile {
     int shortest;
 
     int header_written;
+
+    StageProfile mux_profile;   /* updated by the muxing thread if there is one */
+
+#if HAVE_THREADS
+    AVThreadMessageQueue *mux_thread_queue;
+    pthread_t mux_thread;       /* thread writing packets to this file */
+    int thread_queue_size;      /* maximum number of queued packets */
+    atomic_int_least64_t mux_bytes; /* bytes written so far by the muxing thread */
+#endif
 } OutputFile;
 
 extern InputStream **input_streams;
@@ -599,6 +627,7 @@ extern int debug_ts;
 extern int exit_on_error;
 extern int abort_on_flags;
 extern int print_stats;
+extern float stats_profile;
 extern int qp_hist;
 extern int stdin_interaction;
 extern int frame_bits_per_raw_sample;
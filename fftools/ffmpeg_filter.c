@@ -1004,6 +1004,7 @@ int configure_filtergraph(FilterGraph *fg)
     cleanup_filtergraph(fg);
     if (!(fg->graph = avfilter_graph_alloc()))
         return AVERROR(ENOMEM);
+    fg->graph->profile = stats_profile >= 0;
 
     if (simple) {
         OutputStream *ost = fg->outputs[0]->ost;
@@ -527,6 +527,53 @@ static void put_bitstream_info(AACEncContext *s, const char *name)
     put_bits(&s->pb, 12 - padbits, 0);
 }
 
+typedef struct AACQuantizerSearch {
+    SingleChannelElement *sce;
+    enum RawDataBlockType type;
+    int bitres_alloc;
+    int psy_cutoff;             ///< psy bandwidth as updated by the search
+} AACQuantizerSearch;
+
+static void search_channel(AVCodecContext *avctx, AACEncContext *s,
+                           const AACQuantizerSearch *search, int ch)
+{
+    s->cur_channel      = ch;
+    s->cur_type         = search->type;
+    s->psy.bitres.alloc = search->bitres_alloc;
+    if (s->options.pns && s->coder->mark_pns)
+        s->coder->mark_pns(s, avctx, search->sce);
+    s->coder->search_for_quantizers(avctx, s, search->sce, s->lambda);
+}
+
+static int search_channel_thread(AVCodecContext *avctx, void *arg,
+                                 int jobnr, int threadnr)
+{
+    AACEncContext *s = avctx->priv_data;
+    AACEncContext *t = s->thread_ctx[threadnr];
+    AACQuantizerSearch *search = arg;
+
+    /* everything up to the scratch buffers, which are private to each thread */
+    memcpy(t, s, offsetof(AACEncContext, qcoefs));
+    search_channel(avctx, t, &search[jobnr], jobnr);
+    search[jobnr].psy_cutoff = t->psy.cutoff;
+    return 0;
+}
+
+/**
+ * Run the quantizer search of all channels in parallel, after the psy
+ * analysis of all channel elements. The search of a channel only depends on
+ * its own analysis, so this gives the same result as the serial path as long
+ * as the searches do not change the psy bandwidth.
+ */
+static void search_for_quantizers_parallel(AVCodecContext *avctx, AACEncContext *s,
+                                           AACQuantizerSearch *search)
+{
+    avctx->execute2(avctx, search_channel_thread, search, NULL, s->channels);
+    /* the coder may adjust the psy bandwidth, keep what the serial path
+     * would have left */
+    s->psy.cutoff = search[s->channels - 1].psy_cutoff;
+}
+
 /*
  * Copy input samples.
  * Channels are reordered from libavcodec's default order to AAC order.
@@ -564,8 +611,10 @@ static int aac_encode_frame(AVCodecContext *avctx, AVPacket *avpkt,
     int i, its, ch, w, chans, tag, start_ch, ret, frame_bits;
     int target_bits, rate_bits, too_many_bits, too_few_bits;
     int ms_mode = 0, is_mode = 0, tns_mode = 0, pred_mode = 0;
+    int parallel, psy_cutoff;
     int chan_el_counter[4];
     FFPsyWindowInfo windows[AAC_MAX_CHANNELS];
+    AACQuantizerSearch search[AAC_MAX_CHANNELS];
 
     /* add current frame to queue */
     if (frame) {
@@ -688,7 +737,11 @@ static int aac_encode_frame(AVCodecContext *avctx, AVPacket *avpkt,
             put_bitstream_info(s, LIBAVCODEC_IDENT);
         start_ch = 0;
         target_bits = 0;
-        memset(chan_el_counter, 0, sizeof(chan_el_counter));
+        /* the twoloop search adjusts the bandwidth used by the psy analysis
+         * of the next channel elements, so search each element right after
+         * its analysis until that bandwidth is stable */
+        parallel = s->nb_thread_ctx && s->psy_cutoff_stable;
+        psy_cutoff = s->psy.cutoff;
         for (i = 0; i < s->chan_map[0]; i++) {
             FFPsyWindowInfo* wi = windows + start_ch;
             const float *coeffs[2];
@@ -698,8 +751,6 @@ static int aac_encode_frame(AVCodecContext *avctx, AVPacket *avpkt,
             cpe->common_window = 0;
             memset(cpe->is_mask, 0, sizeof(cpe->is_mask));
             memset(cpe->ms_mask, 0, sizeof(cpe->ms_mask));
-            put_bits(&s->pb, 3, tag);
-            put_bits(&s->pb, 4, chan_el_counter[tag]++);
             for (ch = 0; ch < chans; ch++) {
                 sce = &cpe->ch[ch];
                 coeffs[ch] = sce->coeffs;
@@ -721,13 +772,28 @@ static int aac_encode_frame(AVCodecContext *avctx, AVPacket *avpkt,
                     * (s->lambda / (avctx->global_quality ? avctx->global_quality : 120));
                 s->psy.bitres.alloc /= chans;
             }
-            s->cur_type = tag;
             for (ch = 0; ch < chans; ch++) {
-                s->cur_channel = start_ch + ch;
-                if (s->options.pns && s->coder->mark_pns)
-                    s->coder->mark_pns(s, avctx, &cpe->ch[ch]);
-                s->coder->search_for_quantizers(avctx, s, &cpe->ch[ch], s->lambda);
+                search[start_ch + ch].sce          = &cpe->ch[ch];
+                search[start_ch + ch].type         = tag;
+                search[start_ch + ch].bitres_alloc = s->psy.bitres.alloc;
+                if (!parallel)
+                    search_channel(avctx, s, &search[start_ch + ch], start_ch + ch);
             }
+            start_ch += chans;
+        }
+        if (parallel)
+            search_for_quantizers_parallel(avctx, s, search);
+        s->psy_cutoff_stable = s->psy.cutoff == psy_cutoff;
+        start_ch = 0;
+        memset(chan_el_counter, 0, sizeof(chan_el_counter));
+        for (i = 0; i < s->chan_map[0]; i++) {
+            FFPsyWindowInfo* wi = windows + start_ch;
+            tag      = s->chan_map[i+1];
+            chans    = tag == TYPE_CPE ? 2 : 1;
+            cpe      = &s->cpe[i];
+            put_bits(&s->pb, 3, tag);
+            put_bits(&s->pb, 4, chan_el_counter[tag]++);
+            s->cur_type = tag;
             if (chans > 1
                 && wi[0].window_type[0] == wi[1].window_type[0]
                 && wi[0].window_shape   == wi[1].window_shape) {
@@ -899,6 +965,7 @@ static int aac_encode_frame(AVCodecContext *avctx, AVPacket *avpkt,
 static av_cold int aac_encode_end(AVCodecContext *avctx)
 {
     AACEncContext *s = avctx->priv_data;
+    int i;
 
     av_log(avctx, AV_LOG_INFO, "Qavg: %.3f\n", s->lambda_sum / s->lambda_count);
 
@@ -906,6 +973,9 @@ static av_cold int aac_encode_end(AVCodecContext *avctx)
     ff_mdct_end(&s->mdct128);
     ff_psy_end(&s->psy);
     ff_lpc_end(&s->lpc);
+    for (i = 0; i < s->nb_thread_ctx; i++)
+        av_freep(&s->thread_ctx[i]);
+    av_freep(&s->thread_ctx);
     if (s->psypp)
         ff_psy_preprocess_end(s->psypp);
     av_freep(&s->buffer.samples);
@@ -1105,6 +1175,25 @@ static av_cold int aac_encode_init(AVCodecContext *avctx)
     if (HAVE_MIPSDSP)
         ff_aac_coder_init_mips(s);
 
+    if (avctx->active_thread_type & FF_THREAD_SLICE && s->channels > 1) {
+        s->thread_ctx = av_mallocz_array(avctx->thread_count, sizeof(*s->thread_ctx));
+        if (!s->thread_ctx) {
+            ret = AVERROR(ENOMEM);
+            goto fail;
+        }
+        s->nb_thread_ctx = avctx->thread_count;
+        for (i = 0; i < s->nb_thread_ctx; i++) {
+            AACEncContext *t = av_mallocz(sizeof(*t));
+            if (!t) {
+                ret = AVERROR(ENOMEM);
+                goto fail;
+            }
+            t->abs_pow34   = s->abs_pow34;
+            t->quant_bands = s->quant_bands;
+            s->thread_ctx[i] = t;
+        }
+    }
+
     if ((ret = ff_thread_once(&aac_table_init, &aac_encode_init_tables)) != 0)
         return AVERROR_UNKNOWN;
 
@@ -1156,7 +1245,8 @@ AVCodec ff_aac_encoder = {
     .defaults       = aac_encode_defaults,
     .supported_samplerates = mpeg4audio_sample_rates,
     .caps_internal  = FF_CODEC_CAP_INIT_THREADSAFE,
-    .capabilities   = AV_CODEC_CAP_SMALL_LAST_FRAME | AV_CODEC_CAP_DELAY,
+    .capabilities   = AV_CODEC_CAP_SMALL_LAST_FRAME | AV_CODEC_CAP_DELAY |
+                      AV_CODEC_CAP_SLICE_THREADS,
     .sample_fmts    = (const enum AVSampleFormat[]){ AV_SAMPLE_FMT_FLTP,
                                                      AV_SAMPLE_FMT_NONE },
     .priv_class     = &aacenc_class,
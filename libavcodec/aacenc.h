@@ -402,6 +402,9 @@ typedef struct AACEncContext {
     float lambda_sum;                            ///< sum(lambda), for Qvg reporting
     int lambda_count;                            ///< count(lambda), for Qvg reporting
     enum RawDataBlockType cur_type;              ///< channel group type cur_channel belongs to
+    struct AACEncContext **thread_ctx;           ///< per-thread contexts for the parallel quantizer search
+    int nb_thread_ctx;
+    int psy_cutoff_stable;                       ///< the last quantizer searches left psy.cutoff unchanged
 
     AudioFrameQueue afq;
     DECLARE_ALIGNED(16, int,   qcoefs)[96];      ///< quantized coefficients
@@ -3297,6 +3297,18 @@ typedef struct AVCodecContext {
      * used as reference pictures).
      */
     int extra_hw_frames;
+
+    /**
+     * Maximum number of packets the output of frame threading may lag behind
+     * the input. When set, frames are returned as soon as they are decoded
+     * instead of once all threads have been given a packet, and the decoder
+     * only waits for a frame once this many packets are pending. It is
+     * clipped to thread_count - 1.
+     * 0 (the default) always delays the output by thread_count - 1 packets.
+     * - encoding: unused
+     * - decoding: Set by user before avcodec_open2().
+     */
+    int thread_max_delay;
 } AVCodecContext;
 
 #if FF_API_CODEC_GET_SET
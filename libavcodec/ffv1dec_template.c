@@ -115,6 +115,9 @@ static void RENAME(decode_rgb_frame)(FFV1Context *s, uint8_t *src[4], int w, int
     int bits   = s->avctx->bits_per_raw_sample > 0 ? s->avctx->bits_per_raw_sample : 8;
     int offset = 1 << bits;
     int transparency = s->transparency;
+    int rct     = s->slice_coding_mode != 1;
+    int by_coef = s->slice_rct_by_coef;
+    int ry_coef = s->slice_rct_ry_coef;
 
     for (x = 0; x < 4; x++) {
         sample[x][0] = RENAME(s->sample_buffer) +  x * 2      * (w + 6) + 3;
@@ -139,32 +142,51 @@ static void RENAME(decode_rgb_frame)(FFV1Context *s, uint8_t *src[4], int w, int
             else
                 RENAME(decode_line)(s, w, sample[p], (p + 1)/2, bits + (s->slice_coding_mode != 1));
         }
-        for (x = 0; x < w; x++) {
-            int g = sample[0][1][x];
-            int b = sample[1][1][x];
-            int r = sample[2][1][x];
-            int a = sample[3][1][x];
-
-            if (s->slice_coding_mode != 1) {
-                b -= offset;
-                r -= offset;
-                g -= (b * s->slice_rct_by_coef + r * s->slice_rct_ry_coef) >> 2;
-                b += g;
-                r += g;
+        if (lbd) {
+            uint32_t *dst = (uint32_t*)(src[0] + stride[0]*y);
+
+            for (x = 0; x < w; x++) {
+                int g = sample[0][1][x];
+                int b = sample[1][1][x];
+                int r = sample[2][1][x];
+                int a = sample[3][1][x];
+
+                if (rct) {
+                    b -= offset;
+                    r -= offset;
+                    g -= (b * by_coef + r * ry_coef) >> 2;
+                    b += g;
+                    r += g;
+                }
+
+                dst[x] = b + ((unsigned)g<<8) + ((unsigned)r<<16) + ((unsigned)a<<24);
             }
+        } else {
+            uint16_t *dst[4];
+
+            for (p = 0; p < 3 + transparency; p++)
+                dst[p] = (uint16_t*)(src[p] + stride[p]*y);
+            if (sizeof(TYPE) == 2 && !transparency)
+                FFSWAP(uint16_t*, dst[0], dst[1]);
+
+            for (x = 0; x < w; x++) {
+                int g = sample[0][1][x];
+                int b = sample[1][1][x];
+                int r = sample[2][1][x];
+
+                if (rct) {
+                    b -= offset;
+                    r -= offset;
+                    g -= (b * by_coef + r * ry_coef) >> 2;
+                    b += g;
+                    r += g;
+                }
 
-            if (lbd)
-                *((uint32_t*)(src[0] + x*4 + stride[0]*y)) = b + ((unsigned)g<<8) + ((unsigned)r<<16) + ((unsigned)a<<24);
-            else if (sizeof(TYPE) == 4 || transparency) {
-                *((uint16_t*)(src[0] + x*2 + stride[0]*y)) = g;
-                *((uint16_t*)(src[1] + x*2 + stride[1]*y)) = b;
-                *((uint16_t*)(src[2] + x*2 + stride[2]*y)) = r;
+                dst[0][x] = g;
+                dst[1][x] = b;
+                dst[2][x] = r;
                 if (transparency)
-                    *((uint16_t*)(src[3] + x*2 + stride[3]*y)) = a;
-            } else {
-                *((uint16_t*)(src[0] + x*2 + stride[0]*y)) = b;
-                *((uint16_t*)(src[1] + x*2 + stride[1]*y)) = g;
-                *((uint16_t*)(src[2] + x*2 + stride[2]*y)) = r;
+                    dst[3][x] = sample[3][1][x];
             }
         }
     }
@@ -119,8 +119,15 @@ int ff_frame_thread_encoder_init(AVCodecContext *avctx, AVDictionary *options){
     ThreadContext *c;
 
 
-    if(   !(avctx->thread_type & FF_THREAD_FRAME)
-       || !(avctx->codec->capabilities & AV_CODEC_CAP_INTRA_ONLY))
+    if (!(avctx->thread_type & FF_THREAD_FRAME))
+        return 0;
+
+    if (avctx->codec_id == AV_CODEC_ID_FFV1) {
+        // FFV1 frames are only independent if all of them are keyframes, and
+        // the first pass statistics are gathered over all frames
+        if (avctx->gop_size > 1 || (avctx->flags & AV_CODEC_FLAG_PASS1))
+            return 0;
+    } else if (!(avctx->codec->capabilities & AV_CODEC_CAP_INTRA_ONLY))
         return 0;
 
     if(   !avctx->thread_count
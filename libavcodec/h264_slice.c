@@ -2388,7 +2388,9 @@ static int fill_filter_caches(const H264Context *h, H264SliceContext *sl, int mb
     return 0;
 }
 
-static void loop_filter(const H264Context *h, H264SliceContext *sl, int start_x, int end_x)
+static av_always_inline void filter_mbs(const H264Context *h, H264SliceContext *sl,
+                                        int start_x, int end_x,
+                                        int backup, int filter)
 {
     uint8_t *dest_y, *dest_cb, *dest_cr;
     int linesize, uvlinesize, mb_x, mb_y;
@@ -2397,9 +2399,6 @@ static void loop_filter(const H264Context *h, H264SliceContext *sl, int start_x,
     const int pixel_shift    = h->pixel_shift;
     const int block_h        = 16 >> h->chroma_y_shift;
 
-    if (h->postpone_filter)
-        return;
-
     if (sl->deblocking_filter) {
         for (mb_x = start_x; mb_x < end_x; mb_x++)
             for (mb_y = end_mb_y - FRAME_MBAFF(h); mb_y <= end_mb_y; mb_y++) {
@@ -2435,9 +2434,10 @@ static void loop_filter(const H264Context *h, H264SliceContext *sl, int start_x,
                     linesize   = sl->mb_linesize   = sl->linesize;
                     uvlinesize = sl->mb_uvlinesize = sl->uvlinesize;
                 }
-                backup_mb_border(h, sl, dest_y, dest_cb, dest_cr, linesize,
-                                 uvlinesize, 0);
-                if (fill_filter_caches(h, sl, mb_type))
+                if (backup)
+                    backup_mb_border(h, sl, dest_y, dest_cb, dest_cr, linesize,
+                                     uvlinesize, 0);
+                if (!filter || fill_filter_caches(h, sl, mb_type))
                     continue;
                 sl->chroma_qp[0] = get_chroma_qp(h->ps.pps, 0, h->cur_pic.qscale_table[mb_xy]);
                 sl->chroma_qp[1] = get_chroma_qp(h->ps.pps, 1, h->cur_pic.qscale_table[mb_xy]);
@@ -2458,6 +2458,16 @@ static void loop_filter(const H264Context *h, H264SliceContext *sl, int start_x,
     sl->chroma_qp[1] = get_chroma_qp(h->ps.pps, 1, sl->qscale);
 }
 
+static void loop_filter(const H264Context *h, H264SliceContext *sl, int start_x, int end_x)
+{
+    if (h->postpone_filter)
+        return;
+
+    /* With pipeline_filter, the MBs are only backed up here and are filtered
+     * by loop_filter_rows() once the next row has been decoded. */
+    filter_mbs(h, sl, start_x, end_x, 1, !h->pipeline_filter);
+}
+
 static void predict_field_decoding_flag(const H264Context *h, H264SliceContext *sl)
 {
     const int mb_xy = sl->mb_x + sl->mb_y * h->mb_stride;
@@ -2471,7 +2481,7 @@ static void predict_field_decoding_flag(const H264Context *h, H264SliceContext *
 /**
  * Draw edges and report progress for the last MB row.
  */
-static void decode_finish_row(const H264Context *h, H264SliceContext *sl)
+static void draw_finished_row(const H264Context *h, H264SliceContext *sl)
 {
     int top            = 16 * (sl->mb_y      >> FIELD_PICTURE(h));
     int pic_height     = 16 *  h->mb_height >> FIELD_PICTURE(h);
@@ -2502,6 +2512,16 @@ static void decode_finish_row(const H264Context *h, H264SliceContext *sl)
                               h->picture_structure == PICT_BOTTOM_FIELD);
 }
 
+static void decode_finish_row(const H264Context *h, H264SliceContext *sl)
+{
+    if (h->pipeline_filter) {
+        ff_thread_report_progress2(h->avctx, 0, 0, 1);
+        return;
+    }
+
+    draw_finished_row(h, sl);
+}
+
 static void er_add_slice(H264SliceContext *sl,
                          int startx, int starty,
                          int endx, int endy, int status)
@@ -2725,6 +2745,96 @@ finish:
     return 0;
 }
 
+/**
+ * Check whether the loop filter of the slice in slice_ctx[0] can run on
+ * slice_ctx[1] while the slice is decoded, and set up slice_ctx[1] for it.
+ */
+static int init_pipeline_filter(H264Context *h)
+{
+    H264SliceContext *sl = &h->slice_ctx[0];
+    H264SliceContext *lf = &h->slice_ctx[1];
+
+    if (!HAVE_THREADS || h->nb_slice_ctx < 2 || !sl->deblocking_filter ||
+        h->picture_structure != PICT_FRAME || FRAME_MBAFF(h) || sl->mb_x)
+        return 0;
+
+    if (ff_alloc_entries(h->avctx, 2) < 0)
+        return 0;
+
+    lf->slice_num              = sl->slice_num;
+    lf->slice_type             = sl->slice_type;
+    lf->deblocking_filter      = sl->deblocking_filter;
+    lf->slice_alpha_c0_offset  = sl->slice_alpha_c0_offset;
+    lf->slice_beta_offset      = sl->slice_beta_offset;
+    lf->qp_thresh              = sl->qp_thresh;
+    lf->qscale                 = sl->qscale;
+    lf->list_count             = sl->list_count;
+    lf->mb_mbaff               =
+    lf->mb_field_decoding_flag = 0;
+    lf->linesize               = h->cur_pic_ptr->f->linesize[0];
+    lf->uvlinesize             = h->cur_pic_ptr->f->linesize[1];
+    lf->mb_y                   = sl->mb_y;
+
+    atomic_init(&h->pipeline_end_x, 0);
+    atomic_init(&h->pipeline_end_y, -1);
+
+    return 1;
+}
+
+/**
+ * Loop filter the rows decoded by slice_ctx[0]. Row y is filtered once row
+ * y + 1 is decoded, as the intra prediction of row y + 1 temporarily swaps
+ * the unfiltered last line of row y back into the picture, and the filter of
+ * row y modifies the last lines of row y - 1.
+ */
+static int loop_filter_rows(AVCodecContext *avctx, H264SliceContext *lf)
+{
+    H264Context *h = lf->h264;
+    int mb_y, end_x, end_y;
+
+    for (mb_y = lf->mb_y; ; mb_y++) {
+        ff_thread_await_progress2(avctx, 1, 1, 2);
+        end_y = atomic_load_explicit(&h->pipeline_end_y, memory_order_acquire);
+        if (end_y >= 0 && mb_y >= end_y)
+            break;
+
+        lf->mb_y = mb_y;
+        filter_mbs(h, lf, 0, h->mb_width, 0, 1);
+        draw_finished_row(h, lf);
+        ff_thread_report_progress2(avctx, 1, 1, 1);
+    }
+
+    end_x = atomic_load_explicit(&h->pipeline_end_x, memory_order_relaxed);
+    if (end_x) {
+        lf->mb_y = mb_y;
+        filter_mbs(h, lf, 0, end_x, 0, 1);
+    }
+
+    return 0;
+}
+
+static int decode_slice_pipelined(AVCodecContext *avctx, void *arg,
+                                  int jobnr, int threadnr)
+{
+    H264Context *h       = avctx->priv_data;
+    H264SliceContext *sl = &h->slice_ctx[jobnr];
+    int ret;
+
+    if (jobnr)
+        return loop_filter_rows(avctx, sl);
+
+    ret = decode_slice(avctx, sl);
+
+    /* The rows above sl->mb_y are complete. The MBs of row sl->mb_y before
+     * sl->mb_x are filtered too if the slice ended without errors. */
+    atomic_store_explicit(&h->pipeline_end_x, ret < 0 ? 0 : sl->mb_x,
+                          memory_order_relaxed);
+    atomic_store_explicit(&h->pipeline_end_y, sl->mb_y, memory_order_release);
+    ff_thread_report_progress2(avctx, 0, 0, 2);
+
+    return ret;
+}
+
 /**
  * Call decode_slice() for each context.
  *
@@ -2750,7 +2860,15 @@ int ff_h264_execute_decode_slices(H264Context *h)
         h->slice_ctx[0].next_slice_idx = h->mb_width * h->mb_height;
         h->postpone_filter = 0;
 
-        ret = decode_slice(avctx, &h->slice_ctx[0]);
+        if (init_pipeline_filter(h)) {
+            int rets[2];
+
+            h->pipeline_filter = 1;
+            avctx->execute2(avctx, decode_slice_pipelined, h->slice_ctx, rets, 2);
+            h->pipeline_filter = 0;
+            ret = rets[0];
+        } else
+            ret = decode_slice(avctx, &h->slice_ctx[0]);
         h->mb_y = h->slice_ctx[0].mb_y;
         if (ret < 0)
             goto finish;
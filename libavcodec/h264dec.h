@@ -28,6 +28,8 @@
 #ifndef AVCODEC_H264DEC_H
 #define AVCODEC_H264DEC_H
 
+#include <stdatomic.h>
+
 #include "libavutil/buffer.h"
 #include "libavutil/intreadwrite.h"
 #include "libavutil/thread.h"
@@ -371,6 +373,13 @@ typedef struct H264Context {
      * during normal MB decoding and execute it serially at the end.
      */
     int postpone_filter;
+    /* Set when a single slice is decoded with slice threading. Then the loop
+     * filter runs on slice_ctx[1], two MB rows behind the reconstruction, and
+     * pipeline_end_x/y mark where the decoding of slice_ctx[0] stopped; they
+     * are written by the decoding thread while the filter thread reads them.
+     */
+    int pipeline_filter;
+    atomic_int pipeline_end_x, pipeline_end_y;
 
     /*
      * Set to 1 when the current picture is IDR, 0 otherwise.
@@ -87,6 +87,15 @@ typedef struct Jpeg2000Tile {
     int coord[2][2];                    // border coordinates {{x0, x1}, {y0, y1}}
 } Jpeg2000Tile;
 
+/* A codeblock of a tile, decoded as a separate job when the tiles alone
+ * cannot keep the slice threads busy */
+typedef struct Jpeg2000CblkJob {
+    Jpeg2000Cblk *cblk;
+    Jpeg2000Band *band;
+    int compno;
+    int bandpos;
+} Jpeg2000CblkJob;
+
 typedef struct Jpeg2000DecoderContext {
     AVClass         *class;
     AVCodecContext  *avctx;
@@ -121,6 +130,11 @@ typedef struct Jpeg2000DecoderContext {
     Jpeg2000Tile    *tile;
     Jpeg2000DSPContext dsp;
 
+    Jpeg2000CblkJob *cblk_jobs;
+    unsigned int    cblk_jobs_size;
+    int             cblk_threading; // codeblocks are decoded before the tile jobs run
+    int             dwt_pass;       // pass of the inverse DWT run by jpeg2000_dwt_job()
+
     /*options parameters*/
     int             reduction_factor;
 } Jpeg2000DecoderContext;
@@ -1681,6 +1695,30 @@ static inline void mct_decode(Jpeg2000DecoderContext *s, Jpeg2000Tile *tile)
     s->dsp.mct_decode[tile->codsty[0].transform](src[0], src[1], src[2], csize);
 }
 
+static void decode_cblk_dequant(Jpeg2000DecoderContext *s,
+                                Jpeg2000CodingStyle *codsty,
+                                Jpeg2000Component *comp, Jpeg2000Band *band,
+                                Jpeg2000Cblk *cblk, int bandpos,
+                                Jpeg2000T1Context *t1)
+{
+    int x, y;
+
+    decode_cblk(s, codsty, t1, cblk,
+                cblk->coord[0][1] - cblk->coord[0][0],
+                cblk->coord[1][1] - cblk->coord[1][0],
+                bandpos);
+
+    x = cblk->coord[0][0] - band->coord[0][0];
+    y = cblk->coord[1][0] - band->coord[1][0];
+
+    if (codsty->transform == FF_DWT97)
+        dequantization_float(x, y, cblk, comp, t1, band);
+    else if (codsty->transform == FF_DWT97_INT)
+        dequantization_int_97(x, y, cblk, comp, t1, band);
+    else
+        dequantization_int(x, y, cblk, comp, t1, band);
+}
+
 static inline void tile_codeblocks(Jpeg2000DecoderContext *s, Jpeg2000Tile *tile)
 {
     Jpeg2000T1Context t1;
@@ -1718,22 +1756,8 @@ static inline void tile_codeblocks(Jpeg2000DecoderContext *s, Jpeg2000Tile *tile
                     for (cblkno = 0;
                          cblkno < prec->nb_codeblocks_width * prec->nb_codeblocks_height;
                          cblkno++) {
-                        int x, y;
                         Jpeg2000Cblk *cblk = prec->cblk + cblkno;
-                        decode_cblk(s, codsty, &t1, cblk,
-                                    cblk->coord[0][1] - cblk->coord[0][0],
-                                    cblk->coord[1][1] - cblk->coord[1][0],
-                                    bandpos);
-
-                        x = cblk->coord[0][0] - band->coord[0][0];
-                        y = cblk->coord[1][0] - band->coord[1][0];
-
-                        if (codsty->transform == FF_DWT97)
-                            dequantization_float(x, y, cblk, comp, &t1, band);
-                        else if (codsty->transform == FF_DWT97_INT)
-                            dequantization_int_97(x, y, cblk, comp, &t1, band);
-                        else
-                            dequantization_int(x, y, cblk, comp, &t1, band);
+                        decode_cblk_dequant(s, codsty, comp, band, cblk, bandpos, &t1);
                    } /* end cblk */
                 } /*end prec */
             } /* end band */
@@ -1744,6 +1768,96 @@ static inline void tile_codeblocks(Jpeg2000DecoderContext *s, Jpeg2000Tile *tile
     } /*end comp */
 }
 
+static int jpeg2000_decode_cblk_job(AVCodecContext *avctx, void *td,
+                                   int jobnr, int threadnr)
+{
+    Jpeg2000DecoderContext *s = avctx->priv_data;
+    Jpeg2000Tile *tile        = td;
+    Jpeg2000CblkJob *job      = s->cblk_jobs + jobnr;
+    Jpeg2000CodingStyle *codsty = tile->codsty + job->compno;
+    Jpeg2000T1Context t1;
+
+    t1.stride = (1<<codsty->log2_cblk_width) + 2;
+    decode_cblk_dequant(s, codsty, tile->comp + job->compno, job->band,
+                        job->cblk, job->bandpos, &t1);
+    return 0;
+}
+
+static int jpeg2000_dwt_job(AVCodecContext *avctx, void *td,
+                            int jobnr, int threadnr)
+{
+    Jpeg2000DecoderContext *s   = avctx->priv_data;
+    Jpeg2000Tile *tile          = td;
+    int compno                  = jobnr / avctx->thread_count;
+    Jpeg2000Component *comp     = tile->comp + compno;
+    Jpeg2000CodingStyle *codsty = tile->codsty + compno;
+
+    if (s->dwt_pass < ff_dwt_decode_nb_passes(&comp->dwt))
+        ff_dwt_decode_pass(&comp->dwt,
+                           codsty->transform == FF_DWT97 ? (void*)comp->f_data : (void*)comp->i_data,
+                           s->dwt_pass, jobnr % avctx->thread_count,
+                           avctx->thread_count, threadnr);
+    return 0;
+}
+
+/* Same as tile_codeblocks(), but spreads the codeblocks of the tile and then
+ * the rows and columns of each pass of the inverse DWT over the slice
+ * threads. */
+static int tile_codeblocks_threaded(Jpeg2000DecoderContext *s, Jpeg2000Tile *tile)
+{
+    int compno, reslevelno, bandno, precno, cblkno, ret;
+    int nb_jobs = 0, nb_passes = 0;
+
+    for (compno = 0; compno < s->ncomponents; compno++) {
+        Jpeg2000Component *comp     = tile->comp + compno;
+        Jpeg2000CodingStyle *codsty = tile->codsty + compno;
+
+        if ((ret = ff_dwt_decode_thread_init(&comp->dwt, s->avctx->thread_count)) < 0)
+            return ret;
+        nb_passes = FFMAX(nb_passes, ff_dwt_decode_nb_passes(&comp->dwt));
+
+        for (reslevelno = 0; reslevelno < codsty->nreslevels2decode; reslevelno++) {
+            Jpeg2000ResLevel *rlevel = comp->reslevel + reslevelno;
+            for (bandno = 0; bandno < rlevel->nbands; bandno++) {
+                Jpeg2000Band *band = rlevel->band + bandno;
+                int nb_precincts = rlevel->num_precincts_x * rlevel->num_precincts_y;
+
+                if (band->coord[0][0] == band->coord[0][1] ||
+                    band->coord[1][0] == band->coord[1][1])
+                    continue;
+
+                for (precno = 0; precno < nb_precincts; precno++) {
+                    Jpeg2000Prec *prec = band->prec + precno;
+                    int nb_cblks = prec->nb_codeblocks_width * prec->nb_codeblocks_height;
+
+                    Jpeg2000CblkJob *jobs;
+
+                    jobs = av_fast_realloc(s->cblk_jobs, &s->cblk_jobs_size,
+                                           (nb_jobs + nb_cblks) * sizeof(*s->cblk_jobs));
+                    if (!jobs)
+                        return AVERROR(ENOMEM);
+                    s->cblk_jobs = jobs;
+
+                    for (cblkno = 0; cblkno < nb_cblks; cblkno++) {
+                        Jpeg2000CblkJob *job = s->cblk_jobs + nb_jobs++;
+                        job->cblk    = prec->cblk + cblkno;
+                        job->band    = band;
+                        job->compno  = compno;
+                        job->bandpos = bandno + (reslevelno > 0);
+                    }
+                }
+            }
+        }
+    }
+
+    s->avctx->execute2(s->avctx, jpeg2000_decode_cblk_job, tile, NULL, nb_jobs);
+    for (s->dwt_pass = 0; s->dwt_pass < nb_passes; s->dwt_pass++)
+        s->avctx->execute2(s->avctx, jpeg2000_dwt_job, tile, NULL,
+                           s->ncomponents * s->avctx->thread_count);
+
+    return 0;
+}
+
 #define WRITE_FRAME(D, PIXEL)                                                                     \
     static inline void write_frame_ ## D(Jpeg2000DecoderContext * s, Jpeg2000Tile * tile,         \
                                          AVFrame * picture, int precision)                        \
@@ -1814,7 +1928,8 @@ static int jpeg2000_decode_tile(AVCodecContext *avctx, void *td,
     Jpeg2000Tile *tile = s->tile + jobnr;
     int x;
 
-    tile_codeblocks(s, tile);
+    if (!s->cblk_threading)
+        tile_codeblocks(s, tile);
 
     /* inverse MCT transformation */
     if (tile->codsty[0].mct)
@@ -2219,6 +2334,17 @@ static int jpeg2000_decode_frame(AVCodecContext *avctx, void *data,
     if (ret = jpeg2000_read_bitstream_packets(s))
         goto end;
 
+    /* With fewer tiles than threads, also decode the codeblocks of each tile
+     * in parallel. */
+    s->cblk_threading = (avctx->active_thread_type & FF_THREAD_SLICE) &&
+                        s->numXtiles * s->numYtiles < avctx->thread_count;
+    if (s->cblk_threading) {
+        int tileno;
+        for (tileno = 0; tileno < s->numXtiles * s->numYtiles; tileno++)
+            if ((ret = tile_codeblocks_threaded(s, s->tile + tileno)) < 0)
+                goto end;
+    }
+
     avctx->execute2(avctx, jpeg2000_decode_tile, picture, NULL, s->numXtiles * s->numYtiles);
 
     jpeg2000_dec_cleanup(s);
@@ -2238,6 +2364,16 @@ end:
     return ret;
 }
 
+static av_cold int jpeg2000_decode_close(AVCodecContext *avctx)
+{
+    Jpeg2000DecoderContext *s = avctx->priv_data;
+
+    av_freep(&s->cblk_jobs);
+    s->cblk_jobs_size = 0;
+
+    return 0;
+}
+
 #define OFFSET(x) offsetof(Jpeg2000DecoderContext, x)
 #define VD AV_OPT_FLAG_VIDEO_PARAM | AV_OPT_FLAG_DECODING_PARAM
 
@@ -2263,6 +2399,7 @@ AVCodec ff_jpeg2000_decoder = {
     .priv_data_size   = sizeof(Jpeg2000DecoderContext),
     .init             = jpeg2000_decode_init,
     .decode           = jpeg2000_decode_frame,
+    .close            = jpeg2000_decode_close,
     .priv_class       = &jpeg2000_class,
     .max_lowres       = 5,
     .profiles         = NULL_IF_CONFIG_SMALL(ff_jpeg2000_profiles)
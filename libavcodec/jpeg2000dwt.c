@@ -48,6 +48,14 @@
 #define I_LFTG_X       53274ll
 #define I_PRESHIFT 8
 
+/* The vertical passes of the inverse transforms lift DWT_VSTRIP neighbouring
+ * columns at once. The strip is stored row by row in the line buffer, so
+ * each picture row is read and written in runs of DWT_VSTRIP samples instead
+ * of one sample per row. This is plain C: the inner loops would suit a
+ * vectorizer, but configure disables tree vectorization for gcc, and there
+ * is no SIMD version of these passes. */
+#define DWT_VSTRIP 16
+
 static inline void extend53(int *p, int i0, int i1)
 {
     p[i0 - 1] = p[i0 + 1];
@@ -323,52 +331,106 @@ static void sr_1d53(unsigned *p, int i0, int i1)
         p[2 * i + 1] += (int)(p[2 * i] + p[2 * i + 2]) >> 1;
 }
 
-static void dwt_decode53(DWTContext *s, int *t)
+/* Same as sr_1d53(), applied to n neighbouring columns of a strip.
+ * Row i of the strip starts at p + i * DWT_VSTRIP. */
+static void sr_1d53_v(unsigned *p, int i0, int i1, int n)
 {
-    int lev;
-    int w     = s->linelen[s->ndeclevels - 1][0];
-    int32_t *line = s->i_linebuf;
-    line += 3;
+    int i, c;
 
-    for (lev = 0; lev < s->ndeclevels; lev++) {
-        int lh = s->linelen[lev][0],
-            lv = s->linelen[lev][1],
-            mh = s->mod[lev][0],
-            mv = s->mod[lev][1],
-            lp;
-        int *l;
+    if (i1 <= i0 + 1) {
+        if (i0 == 1)
+            for (c = 0; c < n; c++)
+                p[DWT_VSTRIP + c] = (int)p[DWT_VSTRIP + c] >> 1;
+        return;
+    }
 
-        // HOR_SD
-        l = line + mh;
-        for (lp = 0; lp < lv; lp++) {
-            int i, j = 0;
-            // copy with interleaving
-            for (i = mh; i < lh; i += 2, j++)
-                l[i] = t[w * lp + j];
-            for (i = 1 - mh; i < lh; i += 2, j++)
-                l[i] = t[w * lp + j];
+    for (c = 0; c < n; c++) {
+        p[(i0 - 1) * DWT_VSTRIP + c] = p[(i0 + 1) * DWT_VSTRIP + c];
+        p[ i1      * DWT_VSTRIP + c] = p[(i1 - 2) * DWT_VSTRIP + c];
+        p[(i0 - 2) * DWT_VSTRIP + c] = p[(i0 + 2) * DWT_VSTRIP + c];
+        p[(i1 + 1) * DWT_VSTRIP + c] = p[(i1 - 3) * DWT_VSTRIP + c];
+    }
 
-            sr_1d53(line, mh, mh + lh);
+    for (i = (i0 >> 1); i < (i1 >> 1) + 1; i++) {
+        unsigned *av_restrict d = p + (2 * i)     * DWT_VSTRIP;
+        const unsigned *a       = p + (2 * i - 1) * DWT_VSTRIP;
+        const unsigned *b       = p + (2 * i + 1) * DWT_VSTRIP;
+        for (c = 0; c < n; c++)
+            d[c] -= (int)(a[c] + b[c] + 2) >> 2;
+    }
+    for (i = (i0 >> 1); i < (i1 >> 1); i++) {
+        unsigned *av_restrict d = p + (2 * i + 1) * DWT_VSTRIP;
+        const unsigned *a       = p + (2 * i)     * DWT_VSTRIP;
+        const unsigned *b       = p + (2 * i + 2) * DWT_VSTRIP;
+        for (c = 0; c < n; c++)
+            d[c] += (int)(a[c] + b[c]) >> 1;
+    }
+}
 
-            for (i = 0; i < lh; i++)
-                t[w * lp + i] = l[i];
-        }
+/* Horizontal pass of decomposition level lev over rows [start, end). */
+static void dwt_decode53_rows(DWTContext *s, int32_t *t, int32_t *line,
+                              int lev, int start, int end)
+{
+    int w  = s->linelen[s->ndeclevels - 1][0];
+    int lh = s->linelen[lev][0],
+        mh = s->mod[lev][0],
+        lp;
+    int32_t *l;
 
-        // VER_SD
-        l = line + mv;
-        for (lp = 0; lp < lh; lp++) {
-            int i, j = 0;
-            // copy with interleaving
-            for (i = mv; i < lv; i += 2, j++)
-                l[i] = t[w * j + lp];
-            for (i = 1 - mv; i < lv; i += 2, j++)
-                l[i] = t[w * j + lp];
+    line += 3;
+    l = line + mh;
+    for (lp = start; lp < end; lp++) {
+        int i, j = 0;
+        // copy with interleaving
+        for (i = mh; i < lh; i += 2, j++)
+            l[i] = t[w * lp + j];
+        for (i = 1 - mh; i < lh; i += 2, j++)
+            l[i] = t[w * lp + j];
+
+        sr_1d53(line, mh, mh + lh);
+
+        for (i = 0; i < lh; i++)
+            t[w * lp + i] = l[i];
+    }
+}
 
-            sr_1d53(line, mv, mv + lv);
+/* Vertical pass of decomposition level lev over columns [start, end). */
+static void dwt_decode53_cols(DWTContext *s, int32_t *t, int32_t *line,
+                              int lev, int start, int end)
+{
+    int w  = s->linelen[s->ndeclevels - 1][0];
+    int lv = s->linelen[lev][1],
+        mv = s->mod[lev][1],
+        lp;
+    int32_t *vline = line + 3 * DWT_VSTRIP;
+    int32_t *l     = vline + mv * DWT_VSTRIP;
+
+    for (lp = start; lp < end; lp += DWT_VSTRIP) {
+        int n = FFMIN(DWT_VSTRIP, end - lp);
+        int i, j = 0, c;
+        // copy with interleaving
+        for (i = mv; i < lv; i += 2, j++)
+            for (c = 0; c < n; c++)
+                l[i * DWT_VSTRIP + c] = t[w * j + lp + c];
+        for (i = 1 - mv; i < lv; i += 2, j++)
+            for (c = 0; c < n; c++)
+                l[i * DWT_VSTRIP + c] = t[w * j + lp + c];
+
+        sr_1d53_v(vline, mv, mv + lv, n);
+
+        for (i = 0; i < lv; i++)
+            for (c = 0; c < n; c++)
+                t[w * i + lp + c] = l[i * DWT_VSTRIP + c];
+    }
+}
 
-            for (i = 0; i < lv; i++)
-                t[w * i + lp] = l[i];
-        }
+static void dwt_decode53(DWTContext *s, int *t)
+{
+    int lev;
+
+    for (lev = 0; lev < s->ndeclevels; lev++) {
+        dwt_decode53_rows(s, t, s->i_linebuf, lev, 0, s->linelen[lev][1]);
+        dwt_decode53_cols(s, t, s->i_linebuf, lev, 0, s->linelen[lev][0]);
     }
 }
 
@@ -399,53 +461,124 @@ static void sr_1d97_float(float *p, int i0, int i1)
         p[2 * i + 1] += F_LFTG_ALPHA * (p[2 * i]     + p[2 * i + 2]);
 }
 
-static void dwt_decode97_float(DWTContext *s, float *t)
+static void sr_1d97_float_v(float *p, int i0, int i1, int n)
 {
-    int lev;
-    int w       = s->linelen[s->ndeclevels - 1][0];
-    float *line = s->f_linebuf;
-    float *data = t;
-    /* position at index O of line range [0-5,w+5] cf. extend function */
-    line += 5;
+    int i, c;
 
-    for (lev = 0; lev < s->ndeclevels; lev++) {
-        int lh = s->linelen[lev][0],
-            lv = s->linelen[lev][1],
-            mh = s->mod[lev][0],
-            mv = s->mod[lev][1],
-            lp;
-        float *l;
-        // HOR_SD
-        l = line + mh;
-        for (lp = 0; lp < lv; lp++) {
-            int i, j = 0;
-            // copy with interleaving
-            for (i = mh; i < lh; i += 2, j++)
-                l[i] = data[w * lp + j];
-            for (i = 1 - mh; i < lh; i += 2, j++)
-                l[i] = data[w * lp + j];
-
-            sr_1d97_float(line, mh, mh + lh);
+    if (i1 <= i0 + 1) {
+        for (c = 0; c < n; c++) {
+            if (i0 == 1)
+                p[DWT_VSTRIP + c] *= F_LFTG_K/2;
+            else
+                p[c] *= F_LFTG_X;
+        }
+        return;
+    }
 
-            for (i = 0; i < lh; i++)
-                data[w * lp + i] = l[i];
+    for (i = 1; i <= 4; i++)
+        for (c = 0; c < n; c++) {
+            p[(i0 - i)     * DWT_VSTRIP + c] = p[(i0 + i)     * DWT_VSTRIP + c];
+            p[(i1 + i - 1) * DWT_VSTRIP + c] = p[(i1 - i - 1) * DWT_VSTRIP + c];
         }
 
-        // VER_SD
-        l = line + mv;
-        for (lp = 0; lp < lh; lp++) {
-            int i, j = 0;
-            // copy with interleaving
-            for (i = mv; i < lv; i += 2, j++)
-                l[i] = data[w * j + lp];
-            for (i = 1 - mv; i < lv; i += 2, j++)
-                l[i] = data[w * j + lp];
+    for (i = (i0 >> 1) - 1; i < (i1 >> 1) + 2; i++) {
+        float *av_restrict d = p + (2 * i)     * DWT_VSTRIP;
+        const float *a       = p + (2 * i - 1) * DWT_VSTRIP;
+        const float *b       = p + (2 * i + 1) * DWT_VSTRIP;
+        for (c = 0; c < n; c++)
+            d[c] -= F_LFTG_DELTA * (a[c] + b[c]);
+    }
+    /* step 4 */
+    for (i = (i0 >> 1) - 1; i < (i1 >> 1) + 1; i++) {
+        float *av_restrict d = p + (2 * i + 1) * DWT_VSTRIP;
+        const float *a       = p + (2 * i)     * DWT_VSTRIP;
+        const float *b       = p + (2 * i + 2) * DWT_VSTRIP;
+        for (c = 0; c < n; c++)
+            d[c] -= F_LFTG_GAMMA * (a[c] + b[c]);
+    }
+    /*step 5*/
+    for (i = (i0 >> 1); i < (i1 >> 1) + 1; i++) {
+        float *av_restrict d = p + (2 * i)     * DWT_VSTRIP;
+        const float *a       = p + (2 * i - 1) * DWT_VSTRIP;
+        const float *b       = p + (2 * i + 1) * DWT_VSTRIP;
+        for (c = 0; c < n; c++)
+            d[c] += F_LFTG_BETA  * (a[c] + b[c]);
+    }
+    /* step 6 */
+    for (i = (i0 >> 1); i < (i1 >> 1); i++) {
+        float *av_restrict d = p + (2 * i + 1) * DWT_VSTRIP;
+        const float *a       = p + (2 * i)     * DWT_VSTRIP;
+        const float *b       = p + (2 * i + 2) * DWT_VSTRIP;
+        for (c = 0; c < n; c++)
+            d[c] += F_LFTG_ALPHA * (a[c] + b[c]);
+    }
+}
 
-            sr_1d97_float(line, mv, mv + lv);
+/* Horizontal pass of decomposition level lev over rows [start, end). */
+static void dwt_decode97_float_rows(DWTContext *s, float *data, float *line,
+                                    int lev, int start, int end)
+{
+    int w  = s->linelen[s->ndeclevels - 1][0];
+    int lh = s->linelen[lev][0],
+        mh = s->mod[lev][0],
+        lp;
+    float *l;
 
-            for (i = 0; i < lv; i++)
-                data[w * i + lp] = l[i];
-        }
+    /* position at index O of line range [0-5,w+5] cf. extend function */
+    line += 5;
+    l = line + mh;
+    for (lp = start; lp < end; lp++) {
+        int i, j = 0;
+        // copy with interleaving
+        for (i = mh; i < lh; i += 2, j++)
+            l[i] = data[w * lp + j];
+        for (i = 1 - mh; i < lh; i += 2, j++)
+            l[i] = data[w * lp + j];
+
+        sr_1d97_float(line, mh, mh + lh);
+
+        for (i = 0; i < lh; i++)
+            data[w * lp + i] = l[i];
+    }
+}
+
+/* Vertical pass of decomposition level lev over columns [start, end). */
+static void dwt_decode97_float_cols(DWTContext *s, float *data, float *line,
+                                    int lev, int start, int end)
+{
+    int w  = s->linelen[s->ndeclevels - 1][0];
+    int lv = s->linelen[lev][1],
+        mv = s->mod[lev][1],
+        lp;
+    float *vline = line + 5 * DWT_VSTRIP;
+    float *l     = vline + mv * DWT_VSTRIP;
+
+    for (lp = start; lp < end; lp += DWT_VSTRIP) {
+        int n = FFMIN(DWT_VSTRIP, end - lp);
+        int i, j = 0, c;
+        // copy with interleaving
+        for (i = mv; i < lv; i += 2, j++)
+            for (c = 0; c < n; c++)
+                l[i * DWT_VSTRIP + c] = data[w * j + lp + c];
+        for (i = 1 - mv; i < lv; i += 2, j++)
+            for (c = 0; c < n; c++)
+                l[i * DWT_VSTRIP + c] = data[w * j + lp + c];
+
+        sr_1d97_float_v(vline, mv, mv + lv, n);
+
+        for (i = 0; i < lv; i++)
+            for (c = 0; c < n; c++)
+                data[w * i + lp + c] = l[i * DWT_VSTRIP + c];
+    }
+}
+
+static void dwt_decode97_float(DWTContext *s, float *t)
+{
+    int lev;
+
+    for (lev = 0; lev < s->ndeclevels; lev++) {
+        dwt_decode97_float_rows(s, t, s->f_linebuf, lev, 0, s->linelen[lev][1]);
+        dwt_decode97_float_cols(s, t, s->f_linebuf, lev, 0, s->linelen[lev][0]);
     }
 }
 
@@ -476,62 +609,147 @@ static void sr_1d97_int(int32_t *p, int i0, int i1)
         p[2 * i + 1] += (I_LFTG_ALPHA * (p[2 * i]     + (int64_t)p[2 * i + 2]) + (1 << 15)) >> 16;
 }
 
-static void dwt_decode97_int(DWTContext *s, int32_t *t)
+static void sr_1d97_int_v(int32_t *p, int i0, int i1, int n)
 {
-    int lev;
-    int w       = s->linelen[s->ndeclevels - 1][0];
-    int h       = s->linelen[s->ndeclevels - 1][1];
-    int i;
-    int32_t *line = s->i_linebuf;
-    int32_t *data = t;
+    int i, c;
+
+    if (i1 <= i0 + 1) {
+        for (c = 0; c < n; c++) {
+            if (i0 == 1)
+                p[DWT_VSTRIP + c] = (p[DWT_VSTRIP + c] * I_LFTG_K + (1<<16)) >> 17;
+            else
+                p[c] = (p[c] * I_LFTG_X + (1<<15)) >> 16;
+        }
+        return;
+    }
+
+    for (i = 1; i <= 4; i++)
+        for (c = 0; c < n; c++) {
+            p[(i0 - i)     * DWT_VSTRIP + c] = p[(i0 + i)     * DWT_VSTRIP + c];
+            p[(i1 + i - 1) * DWT_VSTRIP + c] = p[(i1 - i - 1) * DWT_VSTRIP + c];
+        }
+
+    for (i = (i0 >> 1) - 1; i < (i1 >> 1) + 2; i++) {
+        int32_t *av_restrict d = p + (2 * i)     * DWT_VSTRIP;
+        const int32_t *a       = p + (2 * i - 1) * DWT_VSTRIP;
+        const int32_t *b       = p + (2 * i + 1) * DWT_VSTRIP;
+        for (c = 0; c < n; c++)
+            d[c] -= (I_LFTG_DELTA * (a[c] + (int64_t)b[c]) + (1 << 15)) >> 16;
+    }
+    /* step 4 */
+    for (i = (i0 >> 1) - 1; i < (i1 >> 1) + 1; i++) {
+        int32_t *av_restrict d = p + (2 * i + 1) * DWT_VSTRIP;
+        const int32_t *a       = p + (2 * i)     * DWT_VSTRIP;
+        const int32_t *b       = p + (2 * i + 2) * DWT_VSTRIP;
+        for (c = 0; c < n; c++)
+            d[c] -= (I_LFTG_GAMMA * (a[c] + (int64_t)b[c]) + (1 << 15)) >> 16;
+    }
+    /*step 5*/
+    for (i = (i0 >> 1); i < (i1 >> 1) + 1; i++) {
+        int32_t *av_restrict d = p + (2 * i)     * DWT_VSTRIP;
+        const int32_t *a       = p + (2 * i - 1) * DWT_VSTRIP;
+        const int32_t *b       = p + (2 * i + 1) * DWT_VSTRIP;
+        for (c = 0; c < n; c++)
+            d[c] += (I_LFTG_BETA  * (a[c] + (int64_t)b[c]) + (1 << 15)) >> 16;
+    }
+    /* step 6 */
+    for (i = (i0 >> 1); i < (i1 >> 1); i++) {
+        int32_t *av_restrict d = p + (2 * i + 1) * DWT_VSTRIP;
+        const int32_t *a       = p + (2 * i)     * DWT_VSTRIP;
+        const int32_t *b       = p + (2 * i + 2) * DWT_VSTRIP;
+        for (c = 0; c < n; c++)
+            d[c] += (I_LFTG_ALPHA * (a[c] + (int64_t)b[c]) + (1 << 15)) >> 16;
+    }
+}
+
+/* Horizontal pass of decomposition level lev over rows [start, end). */
+static void dwt_decode97_int_rows(DWTContext *s, int32_t *data, int32_t *line,
+                                  int lev, int start, int end)
+{
+    int w  = s->linelen[s->ndeclevels - 1][0];
+    int lh = s->linelen[lev][0],
+        mh = s->mod[lev][0],
+        lp;
+    int32_t *l;
+
     /* position at index O of line range [0-5,w+5] cf. extend function */
     line += 5;
+    l = line + mh;
+    for (lp = start; lp < end; lp++) {
+        int i, j = 0;
+        // rescale with interleaving
+        for (i = mh; i < lh; i += 2, j++)
+            l[i] = ((data[w * lp + j] * I_LFTG_K) + (1 << 15)) >> 16;
+        for (i = 1 - mh; i < lh; i += 2, j++)
+            l[i] = data[w * lp + j];
+
+        sr_1d97_int(line, mh, mh + lh);
+
+        for (i = 0; i < lh; i++)
+            data[w * lp + i] = l[i];
+    }
+}
 
-    for (i = 0; i < w * h; i++)
-        data[i] *= 1LL << I_PRESHIFT;
-
-    for (lev = 0; lev < s->ndeclevels; lev++) {
-        int lh = s->linelen[lev][0],
-            lv = s->linelen[lev][1],
-            mh = s->mod[lev][0],
-            mv = s->mod[lev][1],
-            lp;
-        int32_t *l;
-        // HOR_SD
-        l = line + mh;
-        for (lp = 0; lp < lv; lp++) {
-            int i, j = 0;
-            // rescale with interleaving
-            for (i = mh; i < lh; i += 2, j++)
-                l[i] = ((data[w * lp + j] * I_LFTG_K) + (1 << 15)) >> 16;
-            for (i = 1 - mh; i < lh; i += 2, j++)
-                l[i] = data[w * lp + j];
+/* Vertical pass of decomposition level lev over columns [start, end). */
+static void dwt_decode97_int_cols(DWTContext *s, int32_t *data, int32_t *line,
+                                  int lev, int start, int end)
+{
+    int w  = s->linelen[s->ndeclevels - 1][0];
+    int lv = s->linelen[lev][1],
+        mv = s->mod[lev][1],
+        lp;
+    int32_t *vline = line + 5 * DWT_VSTRIP;
+    int32_t *l     = vline + mv * DWT_VSTRIP;
+
+    for (lp = start; lp < end; lp += DWT_VSTRIP) {
+        int n = FFMIN(DWT_VSTRIP, end - lp);
+        int i, j = 0, c;
+        // rescale with interleaving
+        for (i = mv; i < lv; i += 2, j++)
+            for (c = 0; c < n; c++)
+                l[i * DWT_VSTRIP + c] = ((data[w * j + lp + c] * I_LFTG_K) + (1 << 15)) >> 16;
+        for (i = 1 - mv; i < lv; i += 2, j++)
+            for (c = 0; c < n; c++)
+                l[i * DWT_VSTRIP + c] = data[w * j + lp + c];
+
+        sr_1d97_int_v(vline, mv, mv + lv, n);
+
+        for (i = 0; i < lv; i++)
+            for (c = 0; c < n; c++)
+                data[w * i + lp + c] = l[i * DWT_VSTRIP + c];
+    }
+}
 
-            sr_1d97_int(line, mh, mh + lh);
+/* Scale rows [start, end) up before the integer 9/7 transform, or back down
+ * after it. */
+static void dwt_decode97_int_shift(DWTContext *s, int32_t *data,
+                                   int start, int end, int up)
+{
+    int w = s->linelen[s->ndeclevels - 1][0];
+    int i;
 
-            for (i = 0; i < lh; i++)
-                data[w * lp + i] = l[i];
-        }
+    if (up) {
+        for (i = w * start; i < w * end; i++)
+            data[i] *= 1LL << I_PRESHIFT;
+    } else {
+        for (i = w * start; i < w * end; i++)
+            data[i] = (data[i] + ((1<<I_PRESHIFT)>>1)) >> I_PRESHIFT;
+    }
+}
 
-        // VER_SD
-        l = line + mv;
-        for (lp = 0; lp < lh; lp++) {
-            int i, j = 0;
-            // rescale with interleaving
-            for (i = mv; i < lv; i += 2, j++)
-                l[i] = ((data[w * j + lp] * I_LFTG_K) + (1 << 15)) >> 16;
-            for (i = 1 - mv; i < lv; i += 2, j++)
-                l[i] = data[w * j + lp];
+static void dwt_decode97_int(DWTContext *s, int32_t *t)
+{
+    int lev;
+    int h = s->linelen[s->ndeclevels - 1][1];
 
-            sr_1d97_int(line, mv, mv + lv);
+    dwt_decode97_int_shift(s, t, 0, h, 1);
 
-            for (i = 0; i < lv; i++)
-                data[w * i + lp] = l[i];
-        }
+    for (lev = 0; lev < s->ndeclevels; lev++) {
+        dwt_decode97_int_rows(s, t, s->i_linebuf, lev, 0, s->linelen[lev][1]);
+        dwt_decode97_int_cols(s, t, s->i_linebuf, lev, 0, s->linelen[lev][0]);
     }
 
-    for (i = 0; i < w * h; i++)
-        data[i] = (data[i] + ((1<<I_PRESHIFT)>>1)) >> I_PRESHIFT;
+    dwt_decode97_int_shift(s, t, 0, h, 0);
 }
 
 int ff_jpeg2000_dwt_init(DWTContext *s, int border[2][2],
@@ -556,19 +774,17 @@ int ff_jpeg2000_dwt_init(DWTContext *s, int border[2][2],
             for (j = 0; j < 2; j++)
                 b[i][j] = (b[i][j] + 1) >> 1;
         }
+    s->linebuf_size = (maxlen + (type == FF_DWT53 ? 6 : 12)) * DWT_VSTRIP;
+    s->nb_linebufs  = 1;
     switch (type) {
     case FF_DWT97:
-        s->f_linebuf = av_malloc_array((maxlen + 12), sizeof(*s->f_linebuf));
+        s->f_linebuf = av_malloc_array(s->linebuf_size, sizeof(*s->f_linebuf));
         if (!s->f_linebuf)
             return AVERROR(ENOMEM);
         break;
-     case FF_DWT97_INT:
-        s->i_linebuf = av_malloc_array((maxlen + 12), sizeof(*s->i_linebuf));
-        if (!s->i_linebuf)
-            return AVERROR(ENOMEM);
-        break;
+    case FF_DWT97_INT:
     case FF_DWT53:
-        s->i_linebuf = av_malloc_array((maxlen +  6), sizeof(*s->i_linebuf));
+        s->i_linebuf = av_malloc_array(s->linebuf_size, sizeof(*s->i_linebuf));
         if (!s->i_linebuf)
             return AVERROR(ENOMEM);
         break;
@@ -617,6 +833,91 @@ int ff_dwt_decode(DWTContext *s, void *t)
     return 0;
 }
 
+int ff_dwt_decode_thread_init(DWTContext *s, int nb_threads)
+{
+    if (nb_threads <= s->nb_linebufs)
+        return 0;
+
+    s->nb_linebufs = 0;
+    if (s->type == FF_DWT97) {
+        av_freep(&s->f_linebuf);
+        s->f_linebuf = av_malloc_array(nb_threads, s->linebuf_size * sizeof(*s->f_linebuf));
+        if (!s->f_linebuf)
+            return AVERROR(ENOMEM);
+    } else {
+        av_freep(&s->i_linebuf);
+        s->i_linebuf = av_malloc_array(nb_threads, s->linebuf_size * sizeof(*s->i_linebuf));
+        if (!s->i_linebuf)
+            return AVERROR(ENOMEM);
+    }
+    s->nb_linebufs = nb_threads;
+    return 0;
+}
+
+int ff_dwt_decode_nb_passes(DWTContext *s)
+{
+    if (s->ndeclevels == 0)
+        return 0;
+    return 2 * s->ndeclevels + 2 * (s->type == FF_DWT97_INT);
+}
+
+void ff_dwt_decode_pass(DWTContext *s, void *t, int pass,
+                        int jobnr, int nb_jobs, int threadnr)
+{
+    int lev, len, start, end;
+
+    if (s->type == FF_DWT97_INT) {
+        if (pass == 0 || pass == 2 * s->ndeclevels + 1) {
+            len   = s->linelen[s->ndeclevels - 1][1];
+            start = len *  jobnr      / nb_jobs;
+            end   = len * (jobnr + 1) / nb_jobs;
+            dwt_decode97_int_shift(s, t, start, end, !pass);
+            return;
+        }
+        pass--;
+    }
+
+    lev = pass >> 1;
+    if (!(pass & 1)) {
+        len   = s->linelen[lev][1];
+        start = len *  jobnr      / nb_jobs;
+        end   = len * (jobnr + 1) / nb_jobs;
+    } else {
+        /* split the columns in whole strips */
+        len   = (s->linelen[lev][0] + DWT_VSTRIP - 1) / DWT_VSTRIP;
+        start = len *  jobnr      / nb_jobs * DWT_VSTRIP;
+        end   = FFMIN(len * (jobnr + 1) / nb_jobs * DWT_VSTRIP,
+                      s->linelen[lev][0]);
+    }
+
+    switch (s->type) {
+    case FF_DWT97: {
+        float *line = s->f_linebuf + threadnr * s->linebuf_size;
+        if (!(pass & 1))
+            dwt_decode97_float_rows(s, t, line, lev, start, end);
+        else
+            dwt_decode97_float_cols(s, t, line, lev, start, end);
+        break;
+    }
+    case FF_DWT97_INT: {
+        int32_t *line = s->i_linebuf + threadnr * s->linebuf_size;
+        if (!(pass & 1))
+            dwt_decode97_int_rows(s, t, line, lev, start, end);
+        else
+            dwt_decode97_int_cols(s, t, line, lev, start, end);
+        break;
+    }
+    case FF_DWT53: {
+        int32_t *line = s->i_linebuf + threadnr * s->linebuf_size;
+        if (!(pass & 1))
+            dwt_decode53_rows(s, t, line, lev, start, end);
+        else
+            dwt_decode53_cols(s, t, line, lev, start, end);
+        break;
+    }
+    }
+}
+
 void ff_dwt_destroy(DWTContext *s)
 {
     av_freep(&s->f_linebuf);
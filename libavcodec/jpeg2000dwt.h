@@ -48,6 +48,8 @@ typedef struct DWTContext {
     uint8_t type;                        ///< 0 for 9/7; 1 for 5/3
     int32_t *i_linebuf;                  ///< int buffer used by transform
     float   *f_linebuf;                  ///< float buffer used by transform
+    int linebuf_size;                    ///< size of the buffer used by one thread, in samples
+    int nb_linebufs;                     ///< number of threads the buffer has room for
 } DWTContext;
 
 /**
@@ -63,6 +65,29 @@ int ff_jpeg2000_dwt_init(DWTContext *s, int border[2][2],
 int ff_dwt_encode(DWTContext *s, void *t);
 int ff_dwt_decode(DWTContext *s, void *t);
 
+/**
+ * Make room in the line buffer for ff_dwt_decode_pass() called from up to
+ * nb_threads threads at once.
+ */
+int ff_dwt_decode_thread_init(DWTContext *s, int nb_threads);
+
+/**
+ * Number of passes of the inverse DWT run by ff_dwt_decode_pass().
+ * Each pass must be complete before the next one starts.
+ */
+int ff_dwt_decode_nb_passes(DWTContext *s);
+
+/**
+ * Run part of one pass of the inverse DWT. The pass is split into nb_jobs
+ * independent parts of rows or columns, which can run in parallel.
+ * @param pass     pass index, 0 to ff_dwt_decode_nb_passes() - 1
+ * @param jobnr    part of the pass to run, 0 to nb_jobs - 1
+ * @param threadnr index of the line buffer to use, less than the number of
+ *                 threads given to ff_dwt_decode_thread_init()
+ */
+void ff_dwt_decode_pass(DWTContext *s, void *t, int pass,
+                        int jobnr, int nb_jobs, int threadnr);
+
 void ff_dwt_destroy(DWTContext *s);
 
 #endif /* AVCODEC_JPEG2000DWT_H */
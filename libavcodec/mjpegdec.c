@@ -732,10 +732,11 @@ unk_pixfmt:
     return 0;
 }
 
-static inline int mjpeg_decode_dc(MJpegDecodeContext *s, int dc_index)
+static inline int mjpeg_decode_dc(MJpegDecodeContext *s, GetBitContext *gb,
+                                  int dc_index)
 {
     int code;
-    code = get_vlc2(&s->gb, s->vlcs[0][dc_index].table, 9, 2);
+    code = get_vlc2(gb, s->vlcs[0][dc_index].table, 9, 2);
     if (code < 0 || code > 16) {
         av_log(s->avctx, AV_LOG_WARNING,
                "mjpeg_decode_dc: bad vlc: %d:%d (%p)\n",
@@ -744,47 +745,48 @@ static inline int mjpeg_decode_dc(MJpegDecodeContext *s, int dc_index)
     }
 
     if (code)
-        return get_xbits(&s->gb, code);
+        return get_xbits(gb, code);
     else
         return 0;
 }
 
 /* decode block and dequantize */
-static int decode_block(MJpegDecodeContext *s, int16_t *block, int component,
+static int decode_block(MJpegDecodeContext *s, GetBitContext *gb, int *last_dc,
+                        int16_t *block, int component,
                         int dc_index, int ac_index, uint16_t *quant_matrix)
 {
     int code, i, j, level, val;
 
     /* DC coef */
-    val = mjpeg_decode_dc(s, dc_index);
+    val = mjpeg_decode_dc(s, gb, dc_index);
     if (val == 0xfffff) {
         av_log(s->avctx, AV_LOG_ERROR, "error dc\n");
         return AVERROR_INVALIDDATA;
     }
-    val = val * (unsigned)quant_matrix[0] + s->last_dc[component];
+    val = val * (unsigned)quant_matrix[0] + last_dc[component];
     val = av_clip_int16(val);
-    s->last_dc[component] = val;
+    last_dc[component] = val;
     block[0] = val;
     /* AC coefs */
     i = 0;
-    {OPEN_READER(re, &s->gb);
+    {OPEN_READER(re, gb);
     do {
-        UPDATE_CACHE(re, &s->gb);
-        GET_VLC(code, re, &s->gb, s->vlcs[1][ac_index].table, 9, 2);
+        UPDATE_CACHE(re, gb);
+        GET_VLC(code, re, gb, s->vlcs[1][ac_index].table, 9, 2);
 
         i += ((unsigned)code) >> 4;
             code &= 0xf;
         if (code) {
             if (code > MIN_CACHE_BITS - 16)
-                UPDATE_CACHE(re, &s->gb);
+                UPDATE_CACHE(re, gb);
 
             {
-                int cache = GET_CACHE(re, &s->gb);
+                int cache = GET_CACHE(re, gb);
                 int sign  = (~cache) >> 31;
                 level     = (NEG_USR32(sign ^ cache,code) ^ sign) - sign;
             }
 
-            LAST_SKIP_BITS(re, &s->gb, code);
+            LAST_SKIP_BITS(re, gb, code);
 
             if (i > 63) {
                 av_log(s->avctx, AV_LOG_ERROR, "error count: %d\n", i);
@@ -794,7 +796,7 @@ static int decode_block(MJpegDecodeContext *s, int16_t *block, int component,
             block[j] = level * quant_matrix[i];
         }
     } while (i < 63);
-    CLOSE_READER(re, &s->gb);}
+    CLOSE_READER(re, gb);}
 
     return 0;
 }
@@ -805,7 +807,7 @@ static int decode_dc_progressive(MJpegDecodeContext *s, int16_t *block,
 {
     unsigned val;
     s->bdsp.clear_block(block);
-    val = mjpeg_decode_dc(s, dc_index);
+    val = mjpeg_decode_dc(s, &s->gb, dc_index);
     if (val == 0xfffff) {
         av_log(s->avctx, AV_LOG_ERROR, "error dc\n");
         return AVERROR_INVALIDDATA;
@@ -1073,7 +1075,7 @@ static int ljpeg_decode_rgb_scan(MJpegDecodeContext *s, int nb_components, int p
 
                 PREDICT(pred, topleft[i], top[i], left[i], modified_predictor);
 
-                dc = mjpeg_decode_dc(s, s->dc_index[i]);
+                dc = mjpeg_decode_dc(s, &s->gb, s->dc_index[i]);
                 if(dc == 0xFFFFF)
                     return -1;
 
@@ -1185,7 +1187,7 @@ static int ljpeg_decode_yuv_scan(MJpegDecodeContext *s, int predictor,
                     for(j=0; j<n; j++) {
                         int pred, dc;
 
-                        dc = mjpeg_decode_dc(s, s->dc_index[i]);
+                        dc = mjpeg_decode_dc(s, &s->gb, s->dc_index[i]);
                         if(dc == 0xFFFFF)
                             return -1;
                         if (   h * mb_x + x >= s->width
@@ -1256,7 +1258,7 @@ static int ljpeg_decode_yuv_scan(MJpegDecodeContext *s, int predictor,
                     for (j = 0; j < n; j++) {
                         int pred;
 
-                        dc = mjpeg_decode_dc(s, s->dc_index[i]);
+                        dc = mjpeg_decode_dc(s, &s->gb, s->dc_index[i]);
                         if(dc == 0xFFFFF)
                             return -1;
                         if (   h * mb_x + x >= s->width
@@ -1325,6 +1327,158 @@ static void shift_output(MJpegDecodeContext *s, uint8_t *ptr, int linesize)
     }
 }
 
+#define MAX_SCAN_JOBS 64
+
+typedef struct MJpegScanSlices {
+    MJpegDecodeContext *s;
+    int nb_components;
+    uint8_t *data[MAX_COMPONENTS];
+    int linesize[MAX_COMPONENTS];
+    int chroma_width, chroma_height;
+    int bytes_per_pixel;
+    int scan_start, scan_end;   ///< byte offsets of the scan data in s->buffer
+    const int *rst_pos;         ///< start of the restart intervals after the first one
+    int nb_intervals;
+    int nb_jobs;
+    int end_bits;               ///< bit offset in s->buffer of the end of the last interval
+} MJpegScanSlices;
+
+static int decode_scan_slice(AVCodecContext *avctx, void *arg, int jobnr,
+                             int threadnr)
+{
+    MJpegScanSlices *ss = arg;
+    MJpegDecodeContext *s = ss->s;
+    const int nb_mcus   = s->mb_width * s->mb_height;
+    const int first     =  jobnr      * ss->nb_intervals / ss->nb_jobs;
+    const int last      = (jobnr + 1) * ss->nb_intervals / ss->nb_jobs;
+    LOCAL_ALIGNED_32(int16_t, block, [64]);
+    int last_dc[MAX_COMPONENTS];
+    GetBitContext gb;
+    int n, i, mcu;
+
+    for (n = first; n < last; n++) {
+        int start = n ? ss->rst_pos[n - 1] : ss->scan_start;
+        int end   = n < ss->nb_intervals - 1 ? ss->rst_pos[n] - 2 : ss->scan_end;
+        int ret   = init_get_bits8(&gb, s->buffer + start, FFMAX(end - start, 0));
+        if (ret < 0)
+            return ret;
+
+        for (i = 0; i < ss->nb_components; i++)
+            last_dc[i] = (4 << s->bits);
+
+        for (mcu = n * s->restart_interval;
+             mcu < FFMIN((n + 1) * s->restart_interval, nb_mcus); mcu++) {
+            const int mb_x = mcu % s->mb_width;
+            const int mb_y = mcu / s->mb_width;
+
+            if (get_bits_left(&gb) < 0) {
+                av_log(avctx, AV_LOG_ERROR, "overread %d\n", -get_bits_left(&gb));
+                return AVERROR_INVALIDDATA;
+            }
+            for (i = 0; i < ss->nb_components; i++) {
+                int h = s->h_scount[i];
+                int v = s->v_scount[i];
+                int c = s->comp_index[i];
+                int j, x = 0, y = 0;
+
+                for (j = 0; j < s->nb_blocks[i]; j++) {
+                    int block_offset = (((ss->linesize[c] * (v * mb_y + y) * 8) +
+                                         (h * mb_x + x) * 8 * ss->bytes_per_pixel) >> avctx->lowres);
+                    uint8_t *ptr = NULL;
+
+                    if (s->interlaced && s->bottom_field)
+                        block_offset += ss->linesize[c] >> 1;
+                    if (   8*(h * mb_x + x) < ((c == 1) || (c == 2) ? ss->chroma_width  : s->width)
+                        && 8*(v * mb_y + y) < ((c == 1) || (c == 2) ? ss->chroma_height : s->height))
+                        ptr = ss->data[c] + block_offset;
+
+                    s->bdsp.clear_block(block);
+                    if (decode_block(s, &gb, last_dc, block, i,
+                                     s->dc_index[i], s->ac_index[i],
+                                     s->quant_matrixes[s->quant_sindex[i]]) < 0) {
+                        av_log(avctx, AV_LOG_ERROR,
+                               "error y=%d x=%d\n", mb_y, mb_x);
+                        return AVERROR_INVALIDDATA;
+                    }
+                    if (ptr) {
+                        s->idsp.idct_put(ptr, ss->linesize[c], block);
+                        if (s->bits & 7)
+                            shift_output(s, ptr, ss->linesize[c]);
+                    }
+                    if (++x == h) {
+                        x = 0;
+                        y++;
+                    }
+                }
+            }
+        }
+    }
+    if (last == ss->nb_intervals)
+        ss->end_bits = ss->rst_pos[ss->nb_intervals - 2] * 8 + get_bits_count(&gb);
+
+    return 0;
+}
+
+/**
+ * Decode a sequential scan with restart intervals by running the
+ * intervals, which are independent, in parallel.
+ * @return 1 if the scan was decoded, 0 if it is not suitable, or a negative
+ *         error code
+ */
+static int mjpeg_decode_scan_slices(MJpegDecodeContext *s, int nb_components,
+                                    uint8_t *data[MAX_COMPONENTS],
+                                    const int linesize[MAX_COMPONENTS],
+                                    int chroma_width, int chroma_height)
+{
+    MJpegScanSlices ss = { 0 };
+    int ret[MAX_SCAN_JOBS];
+    int i, first_rst;
+
+    if (s->gb.buffer != s->buffer || s->nb_rst < 0 ||
+        get_bits_count(&s->gb) & 7 || s->restart_interval <= 0)
+        return 0;
+
+    ss.scan_start   = get_bits_count(&s->gb) >> 3;
+    ss.scan_end     = s->gb.size_in_bits >> 3;
+    ss.nb_intervals = (s->mb_width * s->mb_height + s->restart_interval - 1) /
+                      s->restart_interval;
+
+    /* skip the markers of preceding fields, then require exactly one
+     * correctly numbered RSTn marker between consecutive intervals */
+    for (first_rst = 0; first_rst < s->nb_rst; first_rst++)
+        if (s->rst_pos[first_rst] > ss.scan_start)
+            break;
+    if (ss.nb_intervals < 2 || s->nb_rst - first_rst < ss.nb_intervals - 1)
+        return 0;
+    ss.rst_pos = s->rst_pos + first_rst;
+    for (i = 0; i < ss.nb_intervals - 1; i++)
+        if (s->buffer[ss.rst_pos[i] - 1] != RST0 + (i & 7) ||
+            ss.rst_pos[i] - 2 < (i ? ss.rst_pos[i - 1] : ss.scan_start) ||
+            ss.rst_pos[i] > ss.scan_end)
+            return 0;
+
+    ss.s             = s;
+    ss.nb_components = nb_components;
+    ss.chroma_width  = chroma_width;
+    ss.chroma_height = chroma_height;
+    ss.bytes_per_pixel = 1 + (s->bits > 8);
+    for (i = 0; i < MAX_COMPONENTS; i++) {
+        ss.data[i]     = data[i];
+        ss.linesize[i] = linesize[i];
+    }
+    ss.nb_jobs = FFMIN(ss.nb_intervals, FFMIN(4 * s->avctx->thread_count, MAX_SCAN_JOBS));
+
+    s->avctx->execute2(s->avctx, decode_scan_slice, &ss, ret, ss.nb_jobs);
+
+    for (i = 0; i < ss.nb_jobs; i++)
+        if (ret[i] < 0)
+            return ret[i];
+    /* leave s->gb, which reads s->buffer from its start, after the scan */
+    skip_bits_long(&s->gb, ss.end_bits - get_bits_count(&s->gb));
+
+    return 1;
+}
+
 static int mjpeg_decode_scan(MJpegDecodeContext *s, int nb_components, int Ah,
                              int Al, const uint8_t *mb_bitmask,
                              int mb_bitmask_size,
@@ -1360,6 +1514,14 @@ static int mjpeg_decode_scan(MJpegDecodeContext *s, int nb_components, int Ah,
         s->coefs_finished[c] |= 1;
     }
 
+    if (!mb_bitmask && !s->progressive &&
+        s->avctx->active_thread_type & FF_THREAD_SLICE) {
+        int ret = mjpeg_decode_scan_slices(s, nb_components, data, linesize,
+                                           chroma_width, chroma_height);
+        if (ret)
+            return FFMIN(ret, 0);
+    }
+
     for (mb_y = 0; mb_y < s->mb_height; mb_y++) {
         for (mb_x = 0; mb_x < s->mb_width; mb_x++) {
             const int copy_mb = mb_bitmask && !get_bits1(&mb_bitmask_gb);
@@ -1401,7 +1563,7 @@ static int mjpeg_decode_scan(MJpegDecodeContext *s, int nb_components, int Ah,
 
                         } else {
                             s->bdsp.clear_block(s->block);
-                            if (decode_block(s, s->block, i,
+                            if (decode_block(s, &s->gb, s->last_dc, s->block, i,
                                              s->dc_index[i], s->ac_index[i],
                                              s->quant_matrixes[s->quant_sindex[i]]) < 0) {
                                 av_log(s->avctx, AV_LOG_ERROR,
@@ -2117,6 +2279,8 @@ int ff_mjpeg_find_marker(MJpegDecodeContext *s,
         const uint8_t *ptr = src;
         uint8_t *dst = s->buffer;
 
+        s->nb_rst = 0;
+
         #define copy_data_segment(skip) do {       \
             ptrdiff_t length = (ptr - src) - (skip);  \
             if (length > 0) {                         \
@@ -2154,6 +2318,15 @@ int ff_mjpeg_find_marker(MJpegDecodeContext *s,
                         copy_data_segment(1);
                         if (x)
                             break;
+                    } else if (s->nb_rst >= 0) {
+                        /* remember where the data after this RSTn lands */
+                        int *rst_pos = av_fast_realloc(s->rst_pos, &s->rst_pos_size,
+                                                       (s->nb_rst + 1) * sizeof(*s->rst_pos));
+                        if (rst_pos) {
+                            s->rst_pos = rst_pos;
+                            s->rst_pos[s->nb_rst++] = (dst - s->buffer) + (ptr - src);
+                        } else
+                            s->nb_rst = -1;
                     }
                 }
             }
@@ -2728,6 +2901,7 @@ av_cold int ff_mjpeg_decode_end(AVCodecContext *avctx)
         av_frame_unref(s->picture_ptr);
 
     av_freep(&s->buffer);
+    av_freep(&s->rst_pos);
     av_freep(&s->stereo3d);
     av_freep(&s->ljpeg_buffer);
     s->ljpeg_buffer_size = 0;
@@ -2781,7 +2955,7 @@ AVCodec ff_mjpeg_decoder = {
     .close          = ff_mjpeg_decode_end,
     .decode         = ff_mjpeg_decode_frame,
     .flush          = decode_flush,
-    .capabilities   = AV_CODEC_CAP_DR1,
+    .capabilities   = AV_CODEC_CAP_DR1 | AV_CODEC_CAP_SLICE_THREADS,
     .max_lowres     = 3,
     .priv_class     = &mjpegdec_class,
     .caps_internal  = FF_CODEC_CAP_INIT_THREADSAFE |
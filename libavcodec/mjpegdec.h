@@ -113,6 +113,9 @@ typedef struct MJpegDecodeContext {
 
     int restart_interval;
     int restart_count;
+    int *rst_pos;               ///< offsets in buffer of the data following each RSTn marker of the current scan
+    int nb_rst;                 ///< number of entries in rst_pos, -1 if they could not all be stored
+    unsigned int rst_pos_size;
 
     int buggy_avid;
     int cs_itu601;
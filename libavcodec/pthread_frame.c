@@ -135,6 +135,12 @@ typedef struct FrameThreadContext {
                                     * Set for the first N packets, where N is the number of threads.
                                     * While it is set, ff_thread_en/decode_frame won't return any results.
                                     */
+
+    int max_delay;                 /**<
+                                    * Maximum number of packets the output may lag behind the input,
+                                    * 0 to always fill all threads before returning output.
+                                    * Set from AVCodecContext.thread_max_delay.
+                                    */
 } FrameThreadContext;
 
 #define THREAD_SAFE_CALLBACKS(avctx) \
@@ -299,7 +305,9 @@ static int update_context_from_thread(AVCodecContext *dst, AVCodecContext *src,
     }
 
     if (for_user) {
-        dst->delay       = src->thread_count - 1;
+        dst->delay       = src->thread_max_delay > 0 ?
+                           FFMIN(src->thread_max_delay, src->thread_count - 1) :
+                           src->thread_count - 1;
 #if FF_API_CODED_FRAME
 FF_DISABLE_DEPRECATION_WARNINGS
         dst->coded_frame = src->coded_frame;
@@ -498,7 +506,24 @@ int ff_thread_decode_frame(AVCodecContext *avctx,
     if (fctx->next_decoding > (avctx->thread_count-1-(avctx->codec_id == AV_CODEC_ID_FFV1)))
         fctx->delaying = 0;
 
-    if (fctx->delaying) {
+    if (fctx->max_delay && avpkt->size) {
+        /*
+         * Only wait for the oldest thread once max_delay packets are
+         * pending, until then return its frame only if it is done.
+         */
+        int pending = fctx->next_decoding - finished;
+        if (pending <= 0)
+            pending += avctx->thread_count;
+
+        if (pending <= fctx->max_delay &&
+            atomic_load(&fctx->threads[finished].state) != STATE_INPUT_READY) {
+            if (fctx->next_decoding >= avctx->thread_count)
+                fctx->next_decoding = 0;
+            *got_picture_ptr = 0;
+            err = avpkt->size;
+            goto finish;
+        }
+    } else if (fctx->delaying) {
         *got_picture_ptr=0;
         if (avpkt->size) {
             err = avpkt->size;
@@ -763,6 +788,9 @@ int ff_frame_thread_init(AVCodecContext *avctx)
 
     fctx->async_lock = 1;
     fctx->delaying = 1;
+    if (avctx->thread_max_delay > 0)
+        fctx->max_delay = FFMIN(avctx->thread_max_delay,
+                                thread_count - 1 - (avctx->codec_id == AV_CODEC_ID_FFV1));
 
     for (i = 0; i < thread_count; i++) {
         AVCodecContext *copy = av_malloc(sizeof(AVCodecContext));
@@ -0,0 +1,181 @@
+/*
+ * H.264 chroma motion compensation, AVX2
+ *
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "config.h"
+#include "libavutil/attributes.h"
+#include "libavutil/x86/asm.h"
+#include "h264chroma.h"
+
+#if HAVE_AVX2_INLINE
+
+/*
+ * Two rows of 8 pixels are filtered per iteration, one in each lane of a ymm
+ * register of words. The weights sum to 64, so the weighted sum of 10-bit
+ * pixels plus the rounding still fits in an unsigned word.
+ *
+ * The 4-tap filter is used when both x and y are fractional. Otherwise the
+ * 2-tap filter reads, like the C code, only the pixels it needs: the next
+ * pixel (step 1), the next row (step stride) or nothing more (step 0).
+ */
+
+/* load the rows at addresses row0 and row1 into the lanes of ymm<x> */
+#define LOAD_8(x, row0, row1)                                          \
+    "vmovq      "row0",             %%xmm"#x"                      \n\t"\
+    "vmovhps    "row1",             %%xmm"#x", %%xmm"#x"           \n\t"\
+    "vpmovzxbw  %%xmm"#x",          %%ymm"#x"                      \n\t"
+#define LOAD_10(x, row0, row1)                                         \
+    "vmovdqu    "row0",             %%xmm"#x"                      \n\t"\
+    "vinserti128 $1, "row1",        %%ymm"#x", %%ymm"#x"           \n\t"
+
+/* size of a pixel in bytes */
+#define PIXEL_8  "1"
+#define PIXEL_10 "2"
+
+/* ymm0 = (ymm0 + 32) >> 6 */
+#define ROUND                                                          \
+    "vpaddw     %%ymm7,  %%ymm0, %%ymm0                            \n\t"\
+    "vpsrlw     $6,      %%ymm0, %%ymm0                            \n\t"
+
+/* store the rows in the lanes of ymm0, averaged with dst for avg */
+#define STORE_put_8                                                    \
+    "vextracti128 $1, %%ymm0, %%xmm1                               \n\t"\
+    "vpackuswb  %%xmm1,  %%xmm0, %%xmm0                            \n\t"\
+    "vmovq      %%xmm0,  (%0)                                      \n\t"\
+    "vmovhps    %%xmm0,  (%0,%3)                                   \n\t"
+#define STORE_avg_8                                                    \
+    "vextracti128 $1, %%ymm0, %%xmm1                               \n\t"\
+    "vpackuswb  %%xmm1,  %%xmm0, %%xmm0                            \n\t"\
+    "vmovq      (%0),    %%xmm1                                    \n\t"\
+    "vmovhps    (%0,%3), %%xmm1, %%xmm1                            \n\t"\
+    "vpavgb     %%xmm1,  %%xmm0, %%xmm0                            \n\t"\
+    "vmovq      %%xmm0,  (%0)                                      \n\t"\
+    "vmovhps    %%xmm0,  (%0,%3)                                   \n\t"
+#define STORE_put_10                                                   \
+    "vmovdqu    %%xmm0,  (%0)                                      \n\t"\
+    "vextracti128 $1, %%ymm0, (%0,%3)                              \n\t"
+#define STORE_avg_10                                                   \
+    "vmovdqu    (%0),    %%xmm1                                    \n\t"\
+    "vinserti128 $1, (%0,%3), %%ymm1, %%ymm1                       \n\t"\
+    "vpavgw     %%ymm1,  %%ymm0, %%ymm0                            \n\t"\
+    STORE_put_10
+
+#define BROADCAST(reg, arg)                                            \
+    "vmovd        %"#arg", %%xmm"#reg"                             \n\t"\
+    "vpbroadcastw %%xmm"#reg", %%ymm"#reg"                         \n\t"
+
+#define H264_CHROMA_MC8_AVX2(OP, DEPTH, SUFFIX)                                 \
+static void OP ## _h264_chroma_mc8 ## SUFFIX ## _avx2(uint8_t *dst,             \
+                                                      uint8_t *src,             \
+                                                      ptrdiff_t stride,         \
+                                                      int h, int x, int y)      \
+{                                                                               \
+    int A = (8 - x) * (8 - y);                                                  \
+    int B =      x  * (8 - y);                                                  \
+    int C = (8 - x) *      y;                                                   \
+    int D =      x  *      y;                                                   \
+    int rnd = 32;                                                               \
+                                                                                \
+    if (D) {                                                                    \
+        __asm__ volatile(                                                       \
+            BROADCAST(3, 4)                                                     \
+            BROADCAST(4, 5)                                                     \
+            BROADCAST(5, 6)                                                     \
+            BROADCAST(6, 7)                                                     \
+            BROADCAST(7, 8)                                                     \
+            "1:                                                     \n\t"       \
+            LOAD_ ## DEPTH(0, "(%1)", "(%1,%3)")                                \
+            LOAD_ ## DEPTH(1, PIXEL_ ## DEPTH "(%1)",                           \
+                              PIXEL_ ## DEPTH "(%1,%3)")                        \
+            "vpmullw    %%ymm3, %%ymm0, %%ymm0                      \n\t"       \
+            "vpmullw    %%ymm4, %%ymm1, %%ymm1                      \n\t"       \
+            "vpaddw     %%ymm1, %%ymm0, %%ymm0                      \n\t"       \
+            "add        %3,     %1                                  \n\t"       \
+            LOAD_ ## DEPTH(1, "(%1)", "(%1,%3)")                                \
+            LOAD_ ## DEPTH(2, PIXEL_ ## DEPTH "(%1)",                           \
+                              PIXEL_ ## DEPTH "(%1,%3)")                        \
+            "vpmullw    %%ymm5, %%ymm1, %%ymm1                      \n\t"       \
+            "vpmullw    %%ymm6, %%ymm2, %%ymm2                      \n\t"       \
+            "vpaddw     %%ymm1, %%ymm0, %%ymm0                      \n\t"       \
+            "vpaddw     %%ymm2, %%ymm0, %%ymm0                      \n\t"       \
+            ROUND                                                               \
+            STORE_ ## OP ## _ ## DEPTH                                          \
+            "add        %3,     %1                                  \n\t"       \
+            "lea        (%0,%3,2), %0                               \n\t"       \
+            "sub        $2,     %2                                  \n\t"       \
+            "jg         1b                                          \n\t"       \
+            "vzeroupper                                             \n\t"       \
+            : "+&r"(dst), "+&r"(src), "+&r"(h)                                  \
+            : "r"(stride), "rm"(A), "rm"(B), "rm"(C), "rm"(D), "rm"(rnd)        \
+            : XMM_CLOBBERS("%xmm0", "%xmm1", "%xmm2", "%xmm3",                  \
+                           "%xmm4", "%xmm5", "%xmm6", "%xmm7",)                 \
+              "memory"                                                          \
+        );                                                                      \
+    } else {                                                                    \
+        int E = B + C;                                                          \
+        x86_reg step  = C ? stride : B ? (DEPTH + 7) / 8 : 0;                   \
+        x86_reg step2 = step + stride;                                          \
+                                                                                \
+        __asm__ volatile(                                                       \
+            BROADCAST(3, 4)                                                     \
+            BROADCAST(4, 5)                                                     \
+            BROADCAST(7, 6)                                                     \
+            "1:                                                     \n\t"       \
+            LOAD_ ## DEPTH(0, "(%1)",    "(%1,%3)")                             \
+            LOAD_ ## DEPTH(1, "(%1,%7)", "(%1,%8)")                             \
+            "vpmullw    %%ymm3, %%ymm0, %%ymm0                      \n\t"       \
+            "vpmullw    %%ymm4, %%ymm1, %%ymm1                      \n\t"       \
+            "vpaddw     %%ymm1, %%ymm0, %%ymm0                      \n\t"       \
+            ROUND                                                               \
+            STORE_ ## OP ## _ ## DEPTH                                          \
+            "lea        (%1,%3,2), %1                               \n\t"       \
+            "lea        (%0,%3,2), %0                               \n\t"       \
+            "sub        $2,     %2                                  \n\t"       \
+            "jg         1b                                          \n\t"       \
+            "vzeroupper                                             \n\t"       \
+            : "+&r"(dst), "+&r"(src), "+&r"(h)                                  \
+            : "r"(stride), "rm"(A), "rm"(E), "rm"(rnd),                         \
+              "r"(step), "r"(step2)                                             \
+            : XMM_CLOBBERS("%xmm0", "%xmm1", "%xmm2", "%xmm3",                  \
+                           "%xmm4", "%xmm5", "%xmm6", "%xmm7",)                 \
+              "memory"                                                          \
+        );                                                                      \
+    }                                                                           \
+}
+
+H264_CHROMA_MC8_AVX2(put,  8, _rnd)
+H264_CHROMA_MC8_AVX2(avg,  8, _rnd)
+H264_CHROMA_MC8_AVX2(put, 10, _10)
+H264_CHROMA_MC8_AVX2(avg, 10, _10)
+
+av_cold void ff_h264chroma_init_avx2(H264ChromaContext *c, int bit_depth)
+{
+    if (bit_depth <= 8) {
+        c->put_h264_chroma_pixels_tab[0] = put_h264_chroma_mc8_rnd_avx2;
+        c->avg_h264_chroma_pixels_tab[0] = avg_h264_chroma_mc8_rnd_avx2;
+    } else if (bit_depth > 8 && bit_depth <= 10) {
+        c->put_h264_chroma_pixels_tab[0] = put_h264_chroma_mc8_10_avx2;
+        c->avg_h264_chroma_pixels_tab[0] = avg_h264_chroma_mc8_10_avx2;
+    }
+}
+
+#endif /* HAVE_AVX2_INLINE */
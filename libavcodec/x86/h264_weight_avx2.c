@@ -0,0 +1,230 @@
+/*
+ * H.264 weighted prediction, AVX2
+ *
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "config.h"
+#include "libavutil/attributes.h"
+#include "libavutil/macros.h"
+#include "libavutil/x86/asm.h"
+#include "h264dsp.h"
+
+#if HAVE_AVX2_INLINE
+
+/*
+ * The pixels are widened to 16 pixels per ymm register and the products are
+ * computed in 32 bits with pmaddwd, so that the results match the C code for
+ * every weight and offset. ymm4 is zero, ymm5 holds the weight pair of each
+ * dword, ymm6 the offset and xmm7 the shift. ymm3 holds the maximum pixel
+ * value of 10-bit pixels and is a temporary for 8-bit pixels.
+ */
+
+/* widen the words of ymm<x> with ymm<y> (zero or the second source), apply
+ * the weights and leave the saturated 16-bit results in ymm<x>; PACK is
+ * vpackssdw for 8-bit pixels, which are clipped when packed to bytes, and
+ * vpackusdw for 10-bit pixels */
+#define WEIGHT_WORDS(x, y, t, PACK)                                \
+    "vpunpckhwd %%ymm"#y", %%ymm"#x", %%ymm"#t"                \n\t"\
+    "vpunpcklwd %%ymm"#y", %%ymm"#x", %%ymm"#x"                \n\t"\
+    "vpmaddwd   %%ymm5,    %%ymm"#x", %%ymm"#x"                \n\t"\
+    "vpmaddwd   %%ymm5,    %%ymm"#t", %%ymm"#t"                \n\t"\
+    "vpaddd     %%ymm6,    %%ymm"#x", %%ymm"#x"                \n\t"\
+    "vpaddd     %%ymm6,    %%ymm"#t", %%ymm"#t"                \n\t"\
+    "vpsrad     %%xmm7,    %%ymm"#x", %%ymm"#x"                \n\t"\
+    "vpsrad     %%xmm7,    %%ymm"#t", %%ymm"#t"                \n\t"\
+    PACK"       %%ymm"#t", %%ymm"#x", %%ymm"#x"                \n\t"
+
+#define SETUP_WEIGHT                                               \
+    "vmovd        %4,      %%xmm5                              \n\t"\
+    "vpbroadcastd %%xmm5,  %%ymm5                              \n\t"\
+    "vmovd        %5,      %%xmm6                              \n\t"\
+    "vpbroadcastd %%xmm6,  %%ymm6                              \n\t"\
+    "vmovd        %6,      %%xmm7                              \n\t"\
+    "vpcmpeqw     %%ymm3,  %%ymm3, %%ymm3                      \n\t"\
+    "vpsrlw       $6,      %%ymm3, %%ymm3                      \n\t"\
+    "vpxor        %%ymm4,  %%ymm4, %%ymm4                      \n\t"
+
+/* load 16 pixels of the row at operand ptr (or of the next row for LOAD2)
+ * into ymm<x>, or 8 pixels of it and of the next row for 8-pixel blocks */
+#define LOAD_16_8(x, ptr)                                          \
+    "vpmovzxbw  (%"#ptr"),       %%ymm"#x"                     \n\t"
+#define LOAD2_16_8(x, ptr)                                         \
+    "vpmovzxbw  (%"#ptr",%3),    %%ymm"#x"                     \n\t"
+#define LOAD_8_8(x, ptr)                                           \
+    "vmovq      (%"#ptr"),       %%xmm"#x"                     \n\t"\
+    "vmovhps    (%"#ptr",%3),    %%xmm"#x", %%xmm"#x"          \n\t"\
+    "vpmovzxbw  %%xmm"#x",       %%ymm"#x"                     \n\t"
+#define LOAD_16_10(x, ptr)                                         \
+    "vmovdqu    (%"#ptr"),       %%ymm"#x"                     \n\t"
+#define LOAD_8_10(x, ptr)                                          \
+    "vmovdqu    (%"#ptr"),       %%xmm"#x"                     \n\t"\
+    "vinserti128 $1, (%"#ptr",%3), %%ymm"#x", %%ymm"#x"        \n\t"
+
+/* rows 0 and 1 in ymm0 and ymm1 */
+#define STORE_16_8                                                 \
+    "vpackuswb  %%ymm1,  %%ymm0, %%ymm0                        \n\t"\
+    "vpermq     $0xd8,   %%ymm0, %%ymm0                        \n\t"\
+    "vmovdqu    %%xmm0,  (%0)                                  \n\t"\
+    "vextracti128 $1, %%ymm0, (%0,%3)                          \n\t"
+/* rows 0 and 1 in the low and high lane of ymm0 */
+#define STORE_8_8                                                  \
+    "vextracti128 $1, %%ymm0, %%xmm1                           \n\t"\
+    "vpackuswb  %%xmm1,  %%xmm0, %%xmm0                        \n\t"\
+    "vmovq      %%xmm0,  (%0)                                  \n\t"\
+    "vmovhps    %%xmm0,  (%0,%3)                               \n\t"
+#define STORE_16_10                                                \
+    "vpminuw    %%ymm3,  %%ymm0, %%ymm0                        \n\t"\
+    "vmovdqu    %%ymm0,  (%0)                                  \n\t"
+#define STORE_8_10                                                 \
+    "vpminuw    %%ymm3,  %%ymm0, %%ymm0                        \n\t"\
+    "vmovdqu    %%xmm0,  (%0)                                  \n\t"\
+    "vextracti128 $1, %%ymm0, (%0,%3)                          \n\t"
+
+#define WEIGHT_LOOP_16_8                                           \
+    LOAD_16_8(0, 0)                                                \
+    LOAD2_16_8(1, 0)                                               \
+    WEIGHT_WORDS(0, 4, 2, "vpackssdw")                             \
+    WEIGHT_WORDS(1, 4, 2, "vpackssdw")                             \
+    STORE_16_8
+#define WEIGHT_LOOP_8_8                                            \
+    LOAD_8_8(0, 0)                                                 \
+    WEIGHT_WORDS(0, 4, 2, "vpackssdw")                             \
+    STORE_8_8
+#define WEIGHT_LOOP_16_10                                          \
+    LOAD_16_10(0, 0)                                               \
+    WEIGHT_WORDS(0, 4, 2, "vpackusdw")                             \
+    STORE_16_10
+#define WEIGHT_LOOP_8_10                                           \
+    LOAD_8_10(0, 0)                                                \
+    WEIGHT_WORDS(0, 4, 2, "vpackusdw")                             \
+    STORE_8_10
+
+#define BIWEIGHT_LOOP_16_8                                         \
+    LOAD_16_8(0, 0)                                                \
+    LOAD_16_8(1, 1)                                                \
+    WEIGHT_WORDS(0, 1, 2, "vpackssdw")                             \
+    LOAD2_16_8(1, 0)                                               \
+    LOAD2_16_8(2, 1)                                               \
+    WEIGHT_WORDS(1, 2, 3, "vpackssdw")                             \
+    STORE_16_8
+#define BIWEIGHT_LOOP_8_8                                          \
+    LOAD_8_8(0, 0)                                                 \
+    LOAD_8_8(1, 1)                                                 \
+    WEIGHT_WORDS(0, 1, 2, "vpackssdw")                             \
+    STORE_8_8
+#define BIWEIGHT_LOOP_16_10                                        \
+    LOAD_16_10(0, 0)                                               \
+    LOAD_16_10(1, 1)                                               \
+    WEIGHT_WORDS(0, 1, 2, "vpackusdw")                             \
+    STORE_16_10
+#define BIWEIGHT_LOOP_8_10                                         \
+    LOAD_8_10(0, 0)                                                \
+    LOAD_8_10(1, 1)                                                \
+    WEIGHT_WORDS(0, 1, 2, "vpackusdw")                             \
+    STORE_8_10
+
+/* number of rows processed by one iteration of the loops */
+#define ROWS_16_8  2
+#define ROWS_8_8   2
+#define ROWS_16_10 1
+#define ROWS_8_10  2
+
+#define H264_WEIGHT_AVX2(W, DEPTH, SUFFIX)                                  \
+static void h264_weight_ ## W ## SUFFIX ## _avx2(uint8_t *dst,               \
+                                                 ptrdiff_t stride,          \
+                                                 int height, int log2_denom,\
+                                                 int weight, int offset)    \
+{                                                                           \
+    uint8_t *src = dst;                                                     \
+    int shift    = log2_denom;                                              \
+                                                                            \
+    offset = (unsigned)offset << (log2_denom + DEPTH - 8);                  \
+    if (log2_denom)                                                         \
+        offset += 1 << (log2_denom - 1);                                    \
+    weight &= 0xffff;                                                       \
+                                                                            \
+    __asm__ volatile(                                                       \
+        SETUP_WEIGHT                                                        \
+        "1:                                                     \n\t"       \
+        WEIGHT_LOOP_ ## W ## _ ## DEPTH                                     \
+        "lea    (%0,%3," AV_STRINGIFY(ROWS_ ## W ## _ ## DEPTH) "), %0 \n\t"\
+        "sub    $" AV_STRINGIFY(ROWS_ ## W ## _ ## DEPTH) ", %2 \n\t"       \
+        "jg     1b                                              \n\t"       \
+        "vzeroupper                                             \n\t"       \
+        : "+&r"(dst), "+&r"(src), "+&r"(height)                             \
+        : "r"(stride), "rm"(weight), "rm"(offset), "rm"(shift)              \
+        : XMM_CLOBBERS("%xmm0", "%xmm1", "%xmm2", "%xmm3",                  \
+                       "%xmm4", "%xmm5", "%xmm6", "%xmm7",)                 \
+          "memory"                                                          \
+    );                                                                      \
+}                                                                           \
+                                                                            \
+static void h264_biweight_ ## W ## SUFFIX ## _avx2(uint8_t *dst, uint8_t *src,\
+                                                   ptrdiff_t stride,        \
+                                                   int height,              \
+                                                   int log2_denom,          \
+                                                   int weightd, int weights,\
+                                                   int offset)              \
+{                                                                           \
+    int weight = (weightd & 0xffff) | (unsigned)weights << 16;              \
+    int shift  = log2_denom + 1;                                            \
+                                                                            \
+    offset = (unsigned)offset << (DEPTH - 8);                               \
+    offset = (unsigned)((offset + 1) | 1) << log2_denom;                    \
+                                                                            \
+    __asm__ volatile(                                                       \
+        SETUP_WEIGHT                                                        \
+        "1:                                                     \n\t"       \
+        BIWEIGHT_LOOP_ ## W ## _ ## DEPTH                                   \
+        "lea    (%0,%3," AV_STRINGIFY(ROWS_ ## W ## _ ## DEPTH) "), %0 \n\t"\
+        "lea    (%1,%3," AV_STRINGIFY(ROWS_ ## W ## _ ## DEPTH) "), %1 \n\t"\
+        "sub    $" AV_STRINGIFY(ROWS_ ## W ## _ ## DEPTH) ", %2 \n\t"       \
+        "jg     1b                                              \n\t"       \
+        "vzeroupper                                             \n\t"       \
+        : "+&r"(dst), "+&r"(src), "+&r"(height)                             \
+        : "r"(stride), "rm"(weight), "rm"(offset), "rm"(shift)              \
+        : XMM_CLOBBERS("%xmm0", "%xmm1", "%xmm2", "%xmm3",                  \
+                       "%xmm4", "%xmm5", "%xmm6", "%xmm7",)                 \
+          "memory"                                                          \
+    );                                                                      \
+}
+
+H264_WEIGHT_AVX2(16,  8,    )
+H264_WEIGHT_AVX2(8,   8,    )
+H264_WEIGHT_AVX2(16, 10, _10)
+H264_WEIGHT_AVX2(8,  10, _10)
+
+av_cold void ff_h264dsp_init_avx2(H264DSPContext *c, const int bit_depth)
+{
+    if (bit_depth == 8) {
+        c->weight_h264_pixels_tab[0]   = h264_weight_16_avx2;
+        c->weight_h264_pixels_tab[1]   = h264_weight_8_avx2;
+        c->biweight_h264_pixels_tab[0] = h264_biweight_16_avx2;
+        c->biweight_h264_pixels_tab[1] = h264_biweight_8_avx2;
+    } else if (bit_depth == 10) {
+        c->weight_h264_pixels_tab[0]   = h264_weight_16_10_avx2;
+        c->weight_h264_pixels_tab[1]   = h264_weight_8_10_avx2;
+        c->biweight_h264_pixels_tab[0] = h264_biweight_16_10_avx2;
+        c->biweight_h264_pixels_tab[1] = h264_biweight_8_10_avx2;
+    }
+}
+
+#endif /* HAVE_AVX2_INLINE */
@@ -23,6 +23,7 @@
 #include "libavutil/cpu.h"
 #include "libavutil/x86/cpu.h"
 #include "libavcodec/h264chroma.h"
+#include "h264chroma.h"
 
 void ff_put_h264_chroma_mc8_rnd_mmx  (uint8_t *dst, uint8_t *src,
                                       ptrdiff_t stride, int h, int x, int y);
@@ -114,4 +115,9 @@ av_cold void ff_h264chroma_init_x86(H264ChromaContext *c, int bit_depth)
         c->put_h264_chroma_pixels_tab[0] = ff_put_h264_chroma_mc8_10_avx;
         c->avg_h264_chroma_pixels_tab[0] = ff_avg_h264_chroma_mc8_10_avx;
     }
+
+#if HAVE_AVX2_INLINE
+    if (INLINE_AVX2(cpu_flags))
+        ff_h264chroma_init_avx2(c, bit_depth);
+#endif
 }
@@ -23,6 +23,7 @@
 #include "libavutil/x86/asm.h"
 #include "libavutil/x86/cpu.h"
 #include "libavcodec/h264dsp.h"
+#include "h264dsp.h"
 
 /***********************************/
 /* IDCT */
@@ -228,9 +229,9 @@ H264_BIWEIGHT_10_SSE(4,  10)
 av_cold void ff_h264dsp_init_x86(H264DSPContext *c, const int bit_depth,
                                  const int chroma_format_idc)
 {
-#if HAVE_X86ASM
     int cpu_flags = av_get_cpu_flags();
 
+#if HAVE_X86ASM
     if (EXTERNAL_MMXEXT(cpu_flags) && chroma_format_idc <= 1)
         c->h264_loop_filter_strength = ff_h264_loop_filter_strength_mmxext;
 
@@ -444,5 +445,10 @@ av_cold void ff_h264dsp_init_x86(H264DSPContext *c, const int bit_depth,
 #endif /* HAVE_ALIGNED_STACK */
         }
     }
+#endif /* HAVE_X86ASM */
+
+#if HAVE_AVX2_INLINE
+    if (INLINE_AVX2(cpu_flags))
+        ff_h264dsp_init_avx2(c, bit_depth);
 #endif
 }
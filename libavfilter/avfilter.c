@@ -33,6 +33,7 @@
 #include "libavutil/rational.h"
 #include "libavutil/samplefmt.h"
 #include "libavutil/thread.h"
+#include "libavutil/time.h"
 
 #define FF_INTERNAL_FIELDS 1
 #include "framequeue.h"
@@ -192,6 +193,15 @@ int avfilter_link_get_channels(AVFilterLink *link)
 
 void ff_filter_set_ready(AVFilterContext *filter, unsigned priority)
 {
+    AVFilterGraphInternal *gi = filter->graph ? filter->graph->internal : NULL;
+
+    /* with frame threading, neighbours may be activated concurrently */
+    if (gi && gi->frame_execute_running) {
+        ff_mutex_lock(&gi->lock);
+        filter->ready = FFMAX(filter->ready, priority);
+        ff_mutex_unlock(&gi->lock);
+        return;
+    }
     filter->ready = FFMAX(filter->ready, priority);
 }
 
@@ -545,13 +555,22 @@ static int set_enable_expr(AVFilterContext *ctx, const char *expr)
 
 void ff_update_link_current_pts(AVFilterLink *link, int64_t pts)
 {
+    int lock;
+
     if (pts == AV_NOPTS_VALUE)
         return;
+    /* the sink links heap is shared by all the filters of the graph */
+    lock = link->graph && link->age_index >= 0 &&
+           link->graph->internal->frame_execute_running;
+    if (lock)
+        ff_mutex_lock(&link->graph->internal->lock);
     link->current_pts = pts;
     link->current_pts_us = av_rescale_q(pts, link->time_base, AV_TIME_BASE_Q);
     /* TODO use duration */
     if (link->graph && link->age_index >= 0)
         ff_avfilter_graph_update_heap(link->graph, link);
+    if (lock)
+        ff_mutex_unlock(&link->graph->internal->lock);
 }
 
 int avfilter_process_command(AVFilterContext *filter, const char *cmd, const char *arg, char *res, int res_len, int flags)
@@ -1418,16 +1437,68 @@ static int ff_filter_activate_default(AVFilterContext *filter)
 
  */
 
+void ff_filter_profile_start(AVFilterContext *filter, FFFilterProfileTime *t)
+{
+    if (filter->graph && filter->graph->profile) {
+        t->wall = av_gettime_relative();
+        t->cpu  = av_gettime_thread_cpu();
+    }
+}
+
+void ff_filter_profile_stop(AVFilterContext *filter, const FFFilterProfileTime *t)
+{
+    if (filter->graph && filter->graph->profile) {
+        AVFilterProfile *p = &filter->internal->profile;
+        p->wall_time += av_gettime_relative()  - t->wall;
+        p->cpu_time  += av_gettime_thread_cpu() - t->cpu;
+    }
+}
+
+const AVFilterProfile *avfilter_get_profile(AVFilterContext *filter)
+{
+    AVFilterProfile *p = &filter->internal->profile;
+    unsigned i;
+
+    if (!filter->graph || !filter->graph->profile)
+        return NULL;
+
+    p->frames_in = p->frames_out = p->queued = 0;
+    for (i = 0; i < filter->nb_inputs; i++) {
+        AVFilterLink *link = filter->inputs[i];
+        if (!link)
+            continue;
+        p->frames_in  += link->frame_count_in;
+        p->queued     += ff_framequeue_queued_frames(&link->fifo);
+        p->max_queued  = FFMAX(p->max_queued, link->fifo.max_queued);
+    }
+    for (i = 0; i < filter->nb_outputs; i++)
+        if (filter->outputs[i])
+            p->frames_out += filter->outputs[i]->frame_count_in;
+
+    return p;
+}
+
 int ff_filter_activate(AVFilterContext *filter)
 {
+    FFFilterProfileTime t = { 0 };
     int ret;
 
     /* Generic timeline support is not yet implemented but should be easy */
     av_assert1(!(filter->filter->flags & AVFILTER_FLAG_SUPPORT_TIMELINE_GENERIC &&
                  filter->filter->activate));
-    filter->ready = 0;
+    if (filter->graph && filter->graph->internal->frame_execute_running) {
+        ff_mutex_lock(&filter->graph->internal->lock);
+        filter->ready = 0;
+        ff_mutex_unlock(&filter->graph->internal->lock);
+    } else {
+        filter->ready = 0;
+    }
+    ff_filter_profile_start(filter, &t);
     ret = filter->filter->activate ? filter->filter->activate(filter) :
           ff_filter_activate_default(filter);
+    ff_filter_profile_stop(filter, &t);
+    if (filter->graph && filter->graph->profile)
+        filter->internal->profile.activations++;
     if (ret == FFERROR_NOT_READY)
         ret = 0;
     return ret;
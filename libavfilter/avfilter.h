@@ -332,6 +332,12 @@ typedef struct AVFilter {
  */
 #define AVFILTER_THREAD_SLICE (1 << 0)
 
+/**
+ * Activate independent filters of a graph concurrently. Only meaningful in
+ * AVFilterGraph.thread_type.
+ */
+#define AVFILTER_THREAD_FRAME (1 << 1)
+
 typedef struct AVFilterInternal AVFilterInternal;
 
 /** An instance of a filter */
@@ -806,6 +812,46 @@ int avfilter_insert_filter(AVFilterLink *link, AVFilterContext *filt,
  */
 const AVClass *avfilter_get_class(void);
 
+/**
+ * Profiling data of a filter instance, collected when AVFilterGraph.profile
+ * is set.
+ *
+ * The times cover every activation of the filter, including the
+ * filter_frame() and request_frame() callbacks of filters that do not
+ * implement activate(), and the work av_buffersrc_add_frame() and similar
+ * functions do for the source filter in the caller. Frames queued by a
+ * filter on its outputs are processed, and timed, in the activations of
+ * the destination filters.
+ *
+ * sizeof(AVFilterProfile) is not a part of the public ABI, new fields may be
+ * added at the end.
+ */
+typedef struct AVFilterProfile {
+    uint64_t activations;  ///< number of times the filter was activated
+    int64_t  wall_time;    ///< wall clock time spent in the filter, in microseconds
+    /**
+     * CPU time spent in the filter by the thread activating it, in
+     * microseconds. Work done by slice threads is not included. 0 if the
+     * platform does not provide per-thread CPU time.
+     */
+    int64_t  cpu_time;
+    uint64_t frames_in;    ///< number of frames received on all inputs
+    uint64_t frames_out;   ///< number of frames sent on all outputs
+    uint64_t queued;       ///< number of frames currently queued on all inputs
+    uint64_t max_queued;   ///< largest number of frames ever queued on one input
+} AVFilterProfile;
+
+/**
+ * Get the profiling data of a filter.
+ *
+ * @param filter the filter, which must be part of a graph with
+ *               AVFilterGraph.profile set
+ * @return the profiling data, owned by the filter and valid until the next
+ *         call for this filter or until the filter is freed; NULL if
+ *         profiling is not enabled
+ */
+const AVFilterProfile *avfilter_get_profile(AVFilterContext *filter);
+
 typedef struct AVFilterGraphInternal AVFilterGraphInternal;
 
 /**
@@ -896,6 +942,12 @@ typedef struct AVFilterGraph {
 
     char *aresample_swr_opts; ///< swr options to use for the auto-inserted aresample filters, Access ONLY through AVOptions
 
+    /**
+     * If nonzero, collect profiling data for each filter of the graph,
+     * see avfilter_get_profile(). May be set by the caller at any time.
+     */
+    int profile;
+
     /**
      * Private fields
      *
@@ -50,12 +50,15 @@ static const AVOption filtergraph_options[] = {
     { "thread_type", "Allowed thread types", OFFSET(thread_type), AV_OPT_TYPE_FLAGS,
         { .i64 = AVFILTER_THREAD_SLICE }, 0, INT_MAX, F|V|A, "thread_type" },
         { "slice", NULL, 0, AV_OPT_TYPE_CONST, { .i64 = AVFILTER_THREAD_SLICE }, .flags = F|V|A, .unit = "thread_type" },
+        { "frame", NULL, 0, AV_OPT_TYPE_CONST, { .i64 = AVFILTER_THREAD_FRAME }, .flags = F|V|A, .unit = "thread_type" },
     { "threads",     "Maximum number of threads", OFFSET(nb_threads),
         AV_OPT_TYPE_INT,   { .i64 = 0 }, 0, INT_MAX, F|V|A },
     {"scale_sws_opts"       , "default scale filter options"        , OFFSET(scale_sws_opts)        ,
         AV_OPT_TYPE_STRING, {.str = NULL}, 0, 0, F|V },
     {"aresample_swr_opts"   , "default aresample filter options"    , OFFSET(aresample_swr_opts)    ,
         AV_OPT_TYPE_STRING, {.str = NULL}, 0, 0, F|A },
+    { "profile",     "Collect profiling data for each filter", OFFSET(profile),
+        AV_OPT_TYPE_BOOL,  { .i64 = 0 }, 0, 1, F|V|A },
     { NULL },
 };
 
@@ -92,6 +95,12 @@ AVFilterGraph *avfilter_graph_alloc(void)
         return NULL;
     }
 
+    if (ff_mutex_init(&ret->internal->lock, NULL)) {
+        av_freep(&ret->internal);
+        av_freep(&ret);
+        return NULL;
+    }
+
     ret->av_class = &filtergraph_class;
     av_opt_set_defaults(ret);
     ff_framequeue_global_init(&ret->internal->frame_queues);
@@ -135,6 +144,7 @@ void avfilter_graph_free(AVFilterGraph **graph)
     av_freep(&(*graph)->resample_lavr_opts);
 #endif
     av_freep(&(*graph)->filters);
+    ff_mutex_destroy(&(*graph)->internal->lock);
     av_freep(&(*graph)->internal);
     av_freep(graph);
 }
@@ -1439,6 +1449,86 @@ int avfilter_graph_request_oldest(AVFilterGraph *graph)
     return 0;
 }
 
+/**
+ * Tell if activating filter may write to link: its own links, and the
+ * outputs of the filters it sends frames to (see filter_unblock()).
+ */
+static int link_touched_by(const AVFilterContext *filter, const AVFilterLink *link)
+{
+    unsigned i;
+
+    if (!link)
+        return 0;
+    if (link->src == filter || link->dst == filter)
+        return 1;
+    for (i = 0; i < filter->nb_outputs; i++)
+        if (filter->outputs[i] && filter->outputs[i]->dst == link->src)
+            return 1;
+    return 0;
+}
+
+/**
+ * Tell if two filters can not be activated concurrently. Apart from the
+ * readiness of their neighbours, which is updated under a lock, a filter
+ * only touches the links listed in link_touched_by().
+ */
+static int filters_conflict(const AVFilterContext *a, const AVFilterContext *b)
+{
+    unsigned i, j;
+
+    if ((a->filter->flags_internal | b->filter->flags_internal) & FF_FILTER_FLAG_GRAPH_ACCESS)
+        return 1;
+    for (i = 0; i < b->nb_inputs; i++)
+        if (link_touched_by(a, b->inputs[i]))
+            return 1;
+    for (i = 0; i < b->nb_outputs; i++) {
+        const AVFilterLink *out = b->outputs[i];
+        if (!out)
+            continue;
+        if (link_touched_by(a, out))
+            return 1;
+        for (j = 0; j < out->dst->nb_outputs; j++)
+            if (link_touched_by(a, out->dst->outputs[j]))
+                return 1;
+    }
+    return 0;
+}
+
+#define MAX_FRAME_BATCH 32
+
+/**
+ * Activate filter together with as many other ready filters independent
+ * from it and from each other as there are threads.
+ */
+static int run_ready_filters(AVFilterGraph *graph, AVFilterContext *filter)
+{
+    AVFilterContext *batch[MAX_FRAME_BATCH];
+    int rets[MAX_FRAME_BATCH];
+    int nb_batch = 1, max_batch = FFMIN(graph->nb_threads, MAX_FRAME_BATCH);
+    unsigned i;
+    int j;
+
+    batch[0] = filter;
+    for (i = 0; i < graph->nb_filters && nb_batch < max_batch; i++) {
+        AVFilterContext *f = graph->filters[i];
+        if (!f->ready || f == filter)
+            continue;
+        for (j = 0; j < nb_batch; j++)
+            if (filters_conflict(batch[j], f))
+                break;
+        if (j == nb_batch)
+            batch[nb_batch++] = f;
+    }
+    if (nb_batch == 1)
+        return ff_filter_activate(filter);
+
+    graph->internal->frame_execute(graph, batch, rets, nb_batch);
+    for (j = 0; j < nb_batch; j++)
+        if (rets[j] < 0)
+            return rets[j];
+    return 0;
+}
+
 int ff_filter_graph_run_once(AVFilterGraph *graph)
 {
     AVFilterContext *filter;
@@ -1451,5 +1541,7 @@ int ff_filter_graph_run_once(AVFilterGraph *graph)
             filter = graph->filters[i];
     if (!filter->ready)
         return AVERROR(EAGAIN);
+    if (graph->internal->frame_execute)
+        return run_ready_filters(graph, filter);
     return ff_filter_activate(filter);
 }
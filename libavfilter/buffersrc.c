@@ -187,20 +187,12 @@ static int push_frame(AVFilterGraph *graph)
     return 0;
 }
 
-static int av_buffersrc_add_frame_internal(AVFilterContext *ctx,
-                                           AVFrame *frame, int flags)
+static int queue_frame(AVFilterContext *ctx, AVFrame *frame, int flags)
 {
     BufferSourceContext *s = ctx->priv;
     AVFrame *copy;
     int refcounted, ret;
 
-    s->nb_failed_requests = 0;
-
-    if (!frame)
-        return av_buffersrc_close(ctx, AV_NOPTS_VALUE, flags);
-    if (s->eof)
-        return AVERROR(EINVAL);
-
     refcounted = !!frame->buf[0];
 
     if (!(flags & AV_BUFFERSRC_FLAG_NO_CHECK_FORMAT)) {
@@ -248,7 +240,28 @@ static int av_buffersrc_add_frame_internal(AVFilterContext *ctx,
         return ret;
     }
 
-    if ((ret = ctx->output_pads[0].request_frame(ctx->outputs[0])) < 0)
+    return ctx->output_pads[0].request_frame(ctx->outputs[0]);
+}
+
+static int av_buffersrc_add_frame_internal(AVFilterContext *ctx,
+                                           AVFrame *frame, int flags)
+{
+    BufferSourceContext *s = ctx->priv;
+    FFFilterProfileTime t = { 0 };
+    int ret;
+
+    s->nb_failed_requests = 0;
+
+    if (!frame)
+        return av_buffersrc_close(ctx, AV_NOPTS_VALUE, flags);
+    if (s->eof)
+        return AVERROR(EINVAL);
+
+    /* This runs in the caller, outside of any activation of the filter. */
+    ff_filter_profile_start(ctx, &t);
+    ret = queue_frame(ctx, frame, flags);
+    ff_filter_profile_stop(ctx, &t);
+    if (ret < 0)
         return ret;
 
     if ((flags & AV_BUFFERSRC_FLAG_PUSH)) {
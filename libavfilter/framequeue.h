@@ -105,6 +105,11 @@ typedef struct FFFrameQueue {
      */
     int samples_skipped;
 
+    /**
+     * Largest number of frames queued at the same time.
+     */
+    size_t max_queued;
+
 } FFFrameQueue;
 
 /**
@@ -25,6 +25,7 @@
  */
 
 #include "libavutil/internal.h"
+#include "libavutil/thread.h"
 #include "avfilter.h"
 #include "formats.h"
 #include "framepool.h"
@@ -149,10 +150,26 @@ struct AVFilterGraphInternal {
     void *thread;
     avfilter_execute_func *thread_execute;
     FFFrameQueueGlobal frame_queues;
+
+    /**
+     * Activate nb_filters filters concurrently, storing the return value of
+     * ff_filter_activate() for each one in rets. Only set when frame
+     * threading is enabled for the graph.
+     */
+    int (*frame_execute)(AVFilterGraph *graph, AVFilterContext **filters,
+                         int *rets, int nb_filters);
+    /**
+     * Non-zero while frame_execute() runs. Filter readiness and the sink
+     * links heap are then shared between threads and protected by lock.
+     */
+    int frame_execute_running;
+    AVMutex lock;
 };
 
 struct AVFilterInternal {
     avfilter_execute_func *execute;
+
+    AVFilterProfile profile;
 };
 
 /**
@@ -373,6 +390,25 @@ AVFilterContext *ff_filter_alloc(const AVFilter *filter, const char *inst_name);
 
 int ff_filter_activate(AVFilterContext *filter);
 
+typedef struct FFFilterProfileTime {
+    int64_t wall;
+    int64_t cpu;
+} FFFilterProfileTime;
+
+/**
+ * Start timing work done for a filter, if its graph has profiling enabled.
+ * ff_filter_activate() does this around every activation; filters must use
+ * it for work they do outside of activation, in the caller of a public
+ * function.
+ */
+void ff_filter_profile_start(AVFilterContext *filter, FFFilterProfileTime *t);
+
+/**
+ * Add the time elapsed since ff_filter_profile_start() to the profile of
+ * the filter.
+ */
+void ff_filter_profile_stop(AVFilterContext *filter, const FFFilterProfileTime *t);
+
 /**
  * Remove a filter from a graph;
  */
@@ -384,6 +420,12 @@ void ff_filter_graph_remove_filter(AVFilterGraph *graph, AVFilterContext *filter
  */
 #define FF_FILTER_FLAG_HWFRAME_AWARE (1 << 0)
 
+/**
+ * The filter accesses other filters of the graph, e.g. to send them commands,
+ * and must not be activated concurrently with any other filter.
+ */
+#define FF_FILTER_FLAG_GRAPH_ACCESS (1 << 1)
+
 /**
  * Run one round of processing on a filter graph.
  */
@@ -42,6 +42,13 @@ typedef struct ThreadContext {
     AVFilterContext *ctx;
     void *arg;
     int   *rets;
+
+    /* frame threading: workers activating whole filters; the slice
+     * threads may then be requested by several of them at once */
+    AVSliceThread *frame_thread;
+    pthread_mutex_t execute_lock;
+    AVFilterContext **frame_filters;
+    int *frame_rets;
 } ThreadContext;
 
 static void worker_func(void *priv, int jobnr, int threadnr, int nb_jobs, int nb_threads)
@@ -52,9 +59,19 @@ static void worker_func(void *priv, int jobnr, int threadnr, int nb_jobs, int nb
         c->rets[jobnr] = ret;
 }
 
+static void frame_worker_func(void *priv, int jobnr, int threadnr, int nb_jobs, int nb_threads)
+{
+    ThreadContext *c = priv;
+    c->frame_rets[jobnr] = ff_filter_activate(c->frame_filters[jobnr]);
+}
+
 static void slice_thread_uninit(ThreadContext *c)
 {
     avpriv_slicethread_free(&c->thread);
+    if (c->frame_thread) {
+        avpriv_slicethread_free(&c->frame_thread);
+        pthread_mutex_destroy(&c->execute_lock);
+    }
 }
 
 static int thread_execute(AVFilterContext *ctx, avfilter_action_func *func,
@@ -64,15 +81,50 @@ static int thread_execute(AVFilterContext *ctx, avfilter_action_func *func,
 
     if (nb_jobs <= 0)
         return 0;
+    if (c->frame_thread)
+        pthread_mutex_lock(&c->execute_lock);
     c->ctx         = ctx;
     c->arg         = arg;
     c->func        = func;
     c->rets        = ret;
 
     avpriv_slicethread_execute(c->thread, nb_jobs, 0);
+    if (c->frame_thread)
+        pthread_mutex_unlock(&c->execute_lock);
     return 0;
 }
 
+static int frame_execute(AVFilterGraph *graph, AVFilterContext **filters,
+                         int *rets, int nb_filters)
+{
+    ThreadContext *c = graph->internal->thread;
+
+    c->frame_filters = filters;
+    c->frame_rets    = rets;
+
+    graph->internal->frame_execute_running = 1;
+    avpriv_slicethread_execute(c->frame_thread, nb_filters, 0);
+    graph->internal->frame_execute_running = 0;
+    return 0;
+}
+
+static int frame_thread_init(ThreadContext *c, int nb_threads)
+{
+    int ret, err;
+
+    ret = avpriv_slicethread_create(&c->frame_thread, c, frame_worker_func,
+                                    NULL, nb_threads);
+    if (ret <= 1) {
+        avpriv_slicethread_free(&c->frame_thread);
+        return ret;
+    }
+    if ((err = pthread_mutex_init(&c->execute_lock, NULL))) {
+        avpriv_slicethread_free(&c->frame_thread);
+        return AVERROR(err);
+    }
+    return ret;
+}
+
 static int thread_init_internal(ThreadContext *c, int nb_threads)
 {
     nb_threads = avpriv_slicethread_create(&c->thread, c, worker_func, NULL, nb_threads);
@@ -105,6 +157,14 @@ int ff_graph_thread_init(AVFilterGraph *graph)
 
     graph->internal->thread_execute = thread_execute;
 
+    if (graph->thread_type & AVFILTER_THREAD_FRAME) {
+        ret = frame_thread_init(graph->internal->thread, graph->nb_threads);
+        if (ret < 0)
+            return ret;
+        if (ret > 1)
+            graph->internal->frame_execute = frame_execute;
+    }
+
     return 0;
 }
 
@@ -1084,7 +1084,7 @@ typedef struct AVStream {
     struct AVCodecParserContext *parser;
 
     /**
-     * last packet in packet_buffer for this stream when muxing.
+     * last packet in the interleaving queue of this stream when muxing.
      */
     struct AVPacketList *last_in_packet_buffer;
     AVProbeData probe_data;
@@ -1492,6 +1492,7 @@ typedef struct AVFormatContext {
 #define AVFMT_FLAG_FAST_SEEK   0x80000 ///< Enable fast, but inaccurate seeks for some formats
 #define AVFMT_FLAG_SHORTEST   0x100000 ///< Stop muxing when the shortest stream stops.
 #define AVFMT_FLAG_AUTO_BSF   0x200000 ///< Add bitstream filters as requested by the muxer
+#define AVFMT_FLAG_FAST_INFO  0x400000 ///< Trust the frame rates and decoder delays of the container headers in avformat_find_stream_info()
 
     /**
      * Maximum size of the data read from input for determining
@@ -1942,6 +1943,26 @@ typedef struct AVFormatContext {
      * - decoding: set by user
      */
     int skip_estimate_duration_from_pts;
+
+    /**
+     * Number of threads used by avformat_find_stream_info() to decode the
+     * streams in parallel, 0 for automatic. With 1, the streams are decoded
+     * one packet at a time on the calling thread.
+     * - encoding: unused
+     * - decoding: set by user
+     */
+    int analyze_threads;
+
+    /**
+     * Directory of a persistent cache of the input formats and stream
+     * parameters of local files, keyed by their URL, size and modification
+     * time. When set, avformat_open_input() and avformat_find_stream_info()
+     * reuse the results of a previous analysis of the same file instead
+     * of probing and decoding it again.
+     * - encoding: unused
+     * - decoding: set by user
+     */
+    char *probe_cache;
 } AVFormatContext;
 
 #if FF_API_FORMAT_GET_SET
@@ -654,6 +654,13 @@ int ffurl_get_short_seek(URLContext *h)
     return h->prot->url_get_short_seek(h);
 }
 
+int ffurl_get_map(URLContext *h, const uint8_t **map, int64_t *size)
+{
+    if (!h || !h->prot || !h->prot->url_get_map)
+        return AVERROR(ENOSYS);
+    return h->prot->url_get_map(h, map, size);
+}
+
 int ffurl_shutdown(URLContext *h, int flags)
 {
     if (!h || !h->prot || !h->prot->url_shutdown)
@@ -349,6 +349,13 @@ typedef struct AVIOContext {
      * Try to buffer at least this amount of data before flushing it
      */
     int min_packet_size;
+
+    /**
+     * Statistic of the bytes copied between the buffer and the caller by
+     * avio_read(), avio_read_partial() and avio_write().
+     * Set by libavformat, read-only for the user.
+     */
+    int64_t bytes_copied;
 } AVIOContext;
 
 /**
@@ -44,6 +44,14 @@
 
 typedef struct AVIOInternal {
     URLContext *h;
+
+    /* Read-only mapping of the whole input, if the protocol provides one.
+     * fill_buffer() then points s->buffer into it instead of copying, and
+     * buffer keeps the allocated buffer meanwhile. */
+    const uint8_t *map;
+    int64_t map_size;
+    uint8_t *buffer;
+    int buffer_mapped;
 } AVIOInternal;
 
 static void *ff_avio_child_next(void *obj, void *prev)
@@ -77,6 +85,37 @@ const AVClass ff_avio_class = {
 
 static void fill_buffer(AVIOContext *s);
 static int url_resetbuf(AVIOContext *s, int flags);
+static int io_read_packet(void *opaque, uint8_t *buf, int buf_size);
+
+static AVIOInternal *mapped_input(AVIOContext *s)
+{
+    AVIOInternal *internal = s->opaque;
+
+    if (s->read_packet != io_read_packet || s->write_flag || !internal->map)
+        return NULL;
+    return internal;
+}
+
+/* Move the data s->buffer points to in the mapping back into the allocated
+ * buffer, before s->buffer is reallocated or freed. */
+static void unmap_buffer(AVIOContext *s)
+{
+    AVIOInternal *internal = mapped_input(s);
+    uint8_t *buffer;
+
+    if (!internal || !internal->buffer_mapped)
+        return;
+
+    buffer = internal->buffer;
+    memcpy(buffer, s->buffer, s->buf_end - s->buffer);
+    if (s->checksum_ptr)
+        s->checksum_ptr = buffer + (s->checksum_ptr - s->buffer);
+    s->buf_ptr = buffer + (s->buf_ptr - s->buffer);
+    s->buf_end = buffer + (s->buf_end - s->buffer);
+    s->buf_ptr_max = buffer;
+    s->buffer = buffer;
+    internal->buffer_mapped = 0;
+}
 
 int ffio_init_context(AVIOContext *s,
                   unsigned char *buffer,
@@ -215,17 +254,47 @@ void ffio_fill(AVIOContext *s, int b, int count)
     }
 }
 
+static int io_write_packet(void *opaque, uint8_t *buf, int buf_size);
+static int dyn_buf_write(void *opaque, uint8_t *buf, int buf_size);
+
+/**
+ * Like in avio_read(), writes larger than the buffer bypass it when they go
+ * to a protocol or a dynamic buffer. Custom write callbacks still get at
+ * most buffer_size bytes per call and packetized protocols whole packets.
+ */
+static int write_bypasses_buffer(AVIOContext *s, int size)
+{
+    if (s->update_checksum)
+        return 0;
+    if (s->direct)
+        return 1;
+    if (size < s->buffer_size)
+        return 0;
+    if (s->write_packet == dyn_buf_write)
+        return 1;
+    /* the file protocol sets its minimum packet size to its maximum one
+     * only for a larger buffer */
+    return s->write_packet == io_write_packet &&
+           s->max_packet_size <= s->min_packet_size;
+}
+
 void avio_write(AVIOContext *s, const unsigned char *buf, int size)
 {
-    if (s->direct && !s->update_checksum) {
+    if (write_bypasses_buffer(s, size)) {
         avio_flush(s);
-        writeout(s, buf, size);
+        while (size > 0) {
+            int len = s->max_packet_size ? FFMIN(size, s->max_packet_size) : size;
+            writeout(s, buf, len);
+            buf  += len;
+            size -= len;
+        }
         return;
     }
     while (size > 0) {
         int len = FFMIN(s->buf_end - s->buf_ptr, size);
         memcpy(s->buf_ptr, buf, len);
         s->buf_ptr += len;
+        s->bytes_copied += len;
 
         if (s->buf_ptr >= s->buf_end)
             flush_buffer(s);
@@ -528,10 +597,18 @@ void avio_write_marker(AVIOContext *s, int64_t time, enum AVIODataMarkerType typ
 
 static int read_packet_wrapper(AVIOContext *s, uint8_t *buf, int size)
 {
+    AVIOInternal *internal;
     int ret;
 
     if (!s->read_packet)
         return AVERROR(EINVAL);
+    if ((internal = mapped_input(s))) {
+        if (s->pos >= internal->map_size)
+            return AVERROR_EOF;
+        size = FFMIN(size, internal->map_size - s->pos);
+        memcpy(buf, internal->map + s->pos, size);
+        return size;
+    }
     ret = s->read_packet(s->opaque, buf, size);
 #if FF_API_OLD_AVIO_EOF_0
     if (!ret && !s->max_packet_size) {
@@ -548,6 +625,7 @@ static int read_packet_wrapper(AVIOContext *s, uint8_t *buf, int size)
 
 static void fill_buffer(AVIOContext *s)
 {
+    AVIOInternal *internal;
     int max_buffer_size = s->max_packet_size ?
                           s->max_packet_size : IO_BUFFER_SIZE;
     uint8_t *dst        = s->buf_end - s->buffer + max_buffer_size < s->buffer_size ?
@@ -562,6 +640,30 @@ static void fill_buffer(AVIOContext *s)
     if (s->eof_reached)
         return;
 
+    /* point the buffer at the next part of a mapped input, without copying
+     * it; the view is never larger than the allocated buffer, so that
+     * unmap_buffer() can always move it back */
+    if ((internal = mapped_input(s))) {
+        if (s->update_checksum && s->buf_end > s->checksum_ptr)
+            s->checksum = s->update_checksum(s->checksum, s->checksum_ptr,
+                                             s->buf_end - s->checksum_ptr);
+        if (s->pos >= internal->map_size) {
+            s->eof_reached = 1;
+            return;
+        }
+        if (!internal->buffer_mapped) {
+            internal->buffer        = s->buffer;
+            internal->buffer_mapped = 1;
+        }
+        len = FFMIN(s->buffer_size, internal->map_size - s->pos);
+        s->buffer       = (uint8_t *)internal->map + s->pos;
+        s->checksum_ptr = s->buf_ptr = s->buf_ptr_max = s->buffer;
+        s->buf_end      = s->buffer + len;
+        s->pos         += len;
+        s->bytes_read  += len;
+        return;
+    }
+
     if (s->update_checksum && dst == s->buffer) {
         if (s->buf_end > s->checksum_ptr)
             s->checksum = s->update_checksum(s->checksum, s->checksum_ptr,
@@ -684,6 +786,7 @@ int avio_read(AVIOContext *s, unsigned char *buf, int size)
             memcpy(buf, s->buf_ptr, len);
             buf += len;
             s->buf_ptr += len;
+            s->bytes_copied += len;
             size -= len;
         }
     }
@@ -744,6 +847,7 @@ int avio_read_partial(AVIOContext *s, unsigned char *buf, int size)
         len = size;
     memcpy(buf, s->buf_ptr, len);
     s->buf_ptr += len;
+    s->bytes_copied += len;
     if (!len) {
         if (s->error)      return s->error;
         if (avio_feof(s))  return AVERROR_EOF;
@@ -1029,6 +1133,8 @@ int ffio_fdopen(AVIOContext **s, URLContext *h)
     }
     (*s)->short_seek_get = io_short_seek;
     (*s)->av_class = &ff_avio_class;
+    if (!(h->flags & AVIO_FLAG_WRITE))
+        ffurl_get_map(h, &internal->map, &internal->map_size);
     return 0;
 fail:
     av_freep(&internal);
@@ -1062,6 +1168,7 @@ int ffio_ensure_seekback(AVIOContext *s, int64_t buf_size)
     if (buf_size < filled || s->seekable || !s->read_packet)
         return 0;
     av_assert0(!s->write_flag);
+    unmap_buffer(s);
 
     buffer = av_malloc(buf_size);
     if (!buffer)
@@ -1085,6 +1192,7 @@ int ffio_set_buf_size(AVIOContext *s, int buf_size)
     if (!buffer)
         return AVERROR(ENOMEM);
 
+    unmap_buffer(s);
     av_free(s->buffer);
     s->buffer = buffer;
     s->orig_buffer_size =
@@ -1120,6 +1228,7 @@ int ffio_rewind_with_probe_data(AVIOContext *s, unsigned char **bufp, int buf_si
         return AVERROR(EINVAL);
     }
 
+    unmap_buffer(s);
     buffer_size = s->buf_end - s->buffer;
 
     /* the buffers must touch or overlap */
@@ -1199,12 +1308,16 @@ int avio_close(AVIOContext *s)
     internal = s->opaque;
     h        = internal->h;
 
+    if (internal->buffer_mapped)
+        s->buffer = internal->buffer;
     av_freep(&s->opaque);
     av_freep(&s->buffer);
     if (s->write_flag)
-        av_log(s, AV_LOG_DEBUG, "Statistics: %d seeks, %d writeouts\n", s->seek_count, s->writeout_count);
+        av_log(s, AV_LOG_DEBUG, "Statistics: %d seeks, %d writeouts, %"PRId64" bytes copied\n",
+               s->seek_count, s->writeout_count, s->bytes_copied);
     else
-        av_log(s, AV_LOG_DEBUG, "Statistics: %"PRId64" bytes read, %d seeks\n", s->bytes_read, s->seek_count);
+        av_log(s, AV_LOG_DEBUG, "Statistics: %"PRId64" bytes read, %d seeks, %"PRId64" bytes copied\n",
+               s->bytes_read, s->seek_count, s->bytes_copied);
     av_opt_free(s);
 
     avio_context_free(&s);
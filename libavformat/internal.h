@@ -70,6 +70,40 @@ struct AVFormatInternal {
      */
     int nb_interleaved_streams;
 
+    /**
+     * Streams with packets in their interleaving queue, as a binary heap
+     * of stream indices ordered by the first queued packet of each stream.
+     * Muxing only.
+     */
+    int *interleave_heap;
+    unsigned int interleave_heap_size;
+    int nb_queued_streams;
+
+    /**
+     * Comparison function given to the last ff_interleave_add_packet() call.
+     */
+    int (*interleave_compare)(AVFormatContext *, AVPacket *, AVPacket *);
+
+    /**
+     * Counter giving the order in which packets were queued.
+     */
+    int64_t interleave_seq;
+
+    /**
+     * Number of streams taken into account by the max_interleave_delta
+     * check, and number of those with queued packets.
+     */
+    int nb_delta_streams;
+    int nb_queued_delta_streams;
+
+    /**
+     * Index of the queued stream whose last queued packet has the largest
+     * dts, or -1 if it has to be searched again, and that dts in
+     * AV_TIME_BASE units.
+     */
+    int max_dts_stream;
+    int64_t max_dts;
+
     /**
      * This buffer is only needed when packets were already buffered but
      * not decoded, for example to get the codec parameters in MPEG
@@ -144,6 +178,11 @@ struct AVFormatInternal {
      * Prefer the codec framerate for avg_frame_rate computation.
      */
     int prefer_codec_framerate;
+
+    /**
+     * Entry of the probe cache for the input, see probecache.h.
+     */
+    struct FFProbeCache *probe_cache;
 };
 
 struct AVStreamInternal {
@@ -192,6 +231,25 @@ struct AVStreamInternal {
     int need_context_update;
 
     FFFrac *priv_pts;
+
+    /**
+     * First packet of the interleaving queue of the stream, the last one
+     * is AVStream.last_in_packet_buffer.
+     * Muxing only.
+     */
+    struct AVPacketList *first_in_packet_buffer;
+
+    /**
+     * Position of the stream in AVFormatInternal.interleave_heap.
+     */
+    int interleave_heap_pos;
+
+    /**
+     * Nonzero if the first queued packet continues the chunk of the
+     * previous packet of the stream. It then goes before all the other
+     * queued packets, the largest value first.
+     */
+    int64_t interleave_front;
 };
 
 #ifdef __GNUC__
@@ -224,8 +282,10 @@ char *ff_data_to_hex(char *buf, const uint8_t *src, int size, int lowercase);
 int ff_hex_to_data(uint8_t *data, const char *p);
 
 /**
- * Add packet to AVFormatContext->packet_buffer list, determining its
- * interleaved position using compare() function argument.
+ * Add packet to the interleaving queue of its stream, determining its
+ * interleaved position using compare() function argument. The queues are
+ * merged in the order in which inserting all the packets into one sorted
+ * list would put them.
  * @return 0, or < 0 on error
  */
 int ff_interleave_add_packet(AVFormatContext *s, AVPacket *pkt,
@@ -730,6 +790,25 @@ int ff_bprint_to_codecpar_extradata(AVCodecParameters *par, struct AVBPrint *buf
 int ff_interleaved_peek(AVFormatContext *s, int stream,
                         AVPacket *pkt, int add_offset);
 
+/**
+ * Return the first packet of the interleaving queues, or NULL if they are
+ * empty. The packet stays owned by the queue.
+ */
+AVPacket *ff_interleave_queue_peek(AVFormatContext *s);
+
+/**
+ * Remove the first packet of the interleaving queues and return it in pkt,
+ * the caller then owns it.
+ *
+ * @return 0 if a packet was returned, AVERROR(ENOENT) if the queues are empty
+ */
+int ff_interleave_queue_get(AVFormatContext *s, AVPacket *pkt);
+
+/**
+ * Unref and free all the packets of the interleaving queues.
+ */
+void ff_interleave_queue_free(AVFormatContext *s);
+
 
 int ff_lock_avformat(void);
 int ff_unlock_avformat(void);
@@ -152,6 +152,20 @@ typedef struct MOVIndexRange {
     int64_t end;
 } MOVIndexRange;
 
+/**
+ * Position of a sample in the sample tables of a track, used to resolve
+ * the samples of a compact index.
+ */
+typedef struct MOVSampleCursor {
+    unsigned int sample;
+    unsigned int chunk;
+    unsigned int chunk_sample; ///< index of the sample in its chunk
+    unsigned int stsc_index;
+    unsigned int stts_index;
+    unsigned int stts_sample;
+    AVIndexEntry entry;        ///< the resolved sample
+} MOVSampleCursor;
+
 typedef struct MOVStreamContext {
     AVIOContext *pb;
     int pb_is_copied;
@@ -188,6 +202,10 @@ typedef struct MOVStreamContext {
     int64_t current_index;
     MOVIndexRange* index_ranges;
     MOVIndexRange* current_index_range;
+    int compact_index;    ///< samples are resolved from the sample tables, index_entries only holds seek points
+    unsigned int compact_sample_count;
+    int64_t compact_start_dts;
+    MOVSampleCursor cursor;
     unsigned int bytes_per_frame;
     unsigned int samples_per_frame;
     int dv_audio_container;
@@ -261,6 +279,7 @@ typedef struct MOVContext {
     int use_absolute_path;
     int ignore_editlist;
     int advanced_editlist;
+    int compact_index;
     int ignore_chapters;
     int seek_individually;
     int64_t next_root_atom; ///< offset of the next root atom
@@ -271,6 +290,7 @@ typedef struct MOVContext {
     int moov_retry;
     int use_mfra_for;
     int has_looked_for_mfra;
+    int lazy_fragments;
     MOVFragmentIndex frag_index;
     int atom_depth;
     unsigned int aax_mode;  ///< 'aax' file has been detected
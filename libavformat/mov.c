@@ -74,6 +74,7 @@ typedef struct MOVParseTableEntry {
 
 static int mov_read_default(MOVContext *c, AVIOContext *pb, MOVAtom atom);
 static int mov_read_mfra(MOVContext *c, AVIOContext *f);
+static int mov_switch_root(AVFormatContext *s, int64_t target, int index);
 static int64_t add_ctts_entry(MOVStts** ctts_data, unsigned int* ctts_count, unsigned int* allocated_size,
                               int count, int duration);
 
@@ -1149,6 +1150,18 @@ static int mov_read_moov(MOVContext *c, AVIOContext *pb, MOVAtom atom)
     /* we parsed the 'moov' atom, we can terminate the parsing as soon as we find the 'mdat' */
     /* so we don't parse the whole file if over a network */
     c->found_moov=1;
+
+    /* index the fragments from the mfra, so that their moof atoms are only
+     * read once playback or a seek reaches them */
+    if (c->lazy_fragments && c->trex_count && !c->has_looked_for_mfra &&
+        (pb->seekable & AVIO_SEEKABLE_NORMAL)) {
+        c->has_looked_for_mfra = 1;
+        if (mov_read_mfra(c, pb) >= 0 && c->frag_index.nb_items) {
+            av_log(c->fc, AV_LOG_VERBOSE, "%d fragments indexed from the mfra\n",
+                   c->frag_index.nb_items);
+            c->frag_index.complete = 1;
+        }
+    }
     return 0; /* now go for mdat */
 }
 
@@ -1245,7 +1258,8 @@ static int64_t get_stream_info_time(MOVFragmentStreamInfo * frag_stream_info)
     return AV_NOPTS_VALUE;
 }
 
-static int64_t get_frag_time(MOVFragmentIndex *frag_index,
+static int64_t get_frag_time(AVFormatContext *s, AVStream *dst_st,
+                             MOVFragmentIndex *frag_index,
                              int index, int track_id)
 {
     MOVFragmentStreamInfo * frag_stream_info;
@@ -1257,18 +1271,38 @@ static int64_t get_frag_time(MOVFragmentIndex *frag_index,
         return frag_stream_info->sidx_pts;
     }
 
+    if (dst_st) {
+        frag_stream_info = get_frag_stream_info(frag_index, index, dst_st->id);
+        timestamp = get_stream_info_time(frag_stream_info);
+        if (timestamp != AV_NOPTS_VALUE)
+            return timestamp;
+    }
+
     for (i = 0; i < frag_index->item[index].nb_stream_info; i++) {
         frag_stream_info = &frag_index->item[index].stream_info[i];
         timestamp = get_stream_info_time(frag_stream_info);
-        if (timestamp != AV_NOPTS_VALUE)
+        if (timestamp != AV_NOPTS_VALUE) {
+            // the times of the other tracks are in their own time base
+            if (dst_st) {
+                int j;
+                for (j = 0; j < s->nb_streams; j++)
+                    if (s->streams[j]->id == frag_stream_info->id)
+                        break;
+                if (j < s->nb_streams)
+                    timestamp = av_rescale_q(timestamp, s->streams[j]->time_base,
+                                             dst_st->time_base);
+            }
             return timestamp;
+        }
     }
     return AV_NOPTS_VALUE;
 }
 
-static int search_frag_timestamp(MOVFragmentIndex *frag_index,
+static int search_frag_timestamp(AVFormatContext *s, MOVFragmentIndex *frag_index,
                                  AVStream *st, int64_t timestamp)
 {
+    MOVContext *mov = s->priv_data;
+    AVStream *time_st = mov->lazy_fragments ? st : NULL;
     int a, b, m;
     int64_t frag_time;
     int id = -1;
@@ -1286,7 +1320,7 @@ static int search_frag_timestamp(MOVFragmentIndex *frag_index,
 
     while (b - a > 1) {
         m = (a + b) >> 1;
-        frag_time = get_frag_time(frag_index, m, id);
+        frag_time = get_frag_time(s, time_st, frag_index, m, id);
         if (frag_time != AV_NOPTS_VALUE) {
             if (frag_time >= timestamp)
                 b = m;
@@ -3292,6 +3326,392 @@ static int64_t add_ctts_entry(MOVStts** ctts_data, unsigned int* ctts_count, uns
     return *ctts_count;
 }
 
+/**
+ * Expand ctts entries such that we have a 1-1 mapping with samples.
+ */
+static int mov_expand_ctts(MOVStreamContext *sc)
+{
+    MOVStts *ctts_data_old = sc->ctts_data;
+    unsigned int ctts_count_old = sc->ctts_count;
+    unsigned int i, j;
+
+    if (!ctts_data_old)
+        return 0;
+    if (sc->sample_count >= UINT_MAX / sizeof(*sc->ctts_data))
+        return AVERROR(ENOMEM);
+    sc->ctts_count = 0;
+    sc->ctts_allocated_size = 0;
+    sc->ctts_data = av_fast_realloc(NULL, &sc->ctts_allocated_size,
+                            sc->sample_count * sizeof(*sc->ctts_data));
+    if (!sc->ctts_data) {
+        av_free(ctts_data_old);
+        return AVERROR(ENOMEM);
+    }
+
+    memset((uint8_t*)(sc->ctts_data), 0, sc->ctts_allocated_size);
+
+    for (i = 0; i < ctts_count_old &&
+                sc->ctts_count < sc->sample_count; i++)
+        for (j = 0; j < ctts_data_old[i].count &&
+                    sc->ctts_count < sc->sample_count; j++)
+            add_ctts_entry(&sc->ctts_data, &sc->ctts_count,
+                           &sc->ctts_allocated_size, 1,
+                           ctts_data_old[i].duration);
+    av_free(ctts_data_old);
+    return 0;
+}
+
+/*
+ * Compact index
+ *
+ * For tracks with simple sample tables, st->index_entries only holds the
+ * seek points of the track: its sync samples or, when all samples are sync
+ * samples, the first sample of a chunk about every second. The samples are
+ * resolved from the stts/stsc/stsz/stco tables with a cursor, which moves
+ * forward in constant time while demuxing and is repositioned from the
+ * tables when seeking.
+ */
+
+static unsigned int mov_sample_size(MOVStreamContext *sc, unsigned int sample)
+{
+    return sc->stsz_sample_size > 0 ? sc->stsz_sample_size : sc->sample_sizes[sample];
+}
+
+/* Index of the first stss entry referring to a sample >= sample. */
+static unsigned int mov_stss_search(MOVStreamContext *sc, int64_t sample)
+{
+    int64_t wanted = sample + (sc->keyframes[0] > 0);
+    unsigned int a = 0, b = sc->keyframe_count;
+
+    while (a < b) {
+        unsigned int m = (a + b) >> 1;
+        if (sc->keyframes[m] < wanted)
+            a = m + 1;
+        else
+            b = m;
+    }
+    return a;
+}
+
+/* Last sync sample at or before sample, -1 if there is none. */
+static int64_t mov_compact_prev_keyframe(AVStream *st, int64_t sample)
+{
+    MOVStreamContext *sc = st->priv_data;
+    unsigned int i;
+
+    if (sample < 0)
+        return -1;
+    if (sc->keyframe_absent)
+        return st->codecpar->codec_type == AVMEDIA_TYPE_AUDIO ? sample : 0;
+    if (!sc->keyframe_count)
+        return sample;
+    i = mov_stss_search(sc, sample + 1);
+    return i ? sc->keyframes[i - 1] - (sc->keyframes[0] > 0) : -1;
+}
+
+/* First sync sample at or after sample, the sample count if there is none. */
+static int64_t mov_compact_next_keyframe(AVStream *st, int64_t sample)
+{
+    MOVStreamContext *sc = st->priv_data;
+    int64_t nb_samples = sc->compact_sample_count;
+    unsigned int i;
+
+    if (sample >= nb_samples)
+        return nb_samples;
+    if (sc->keyframe_absent) {
+        if (st->codecpar->codec_type == AVMEDIA_TYPE_AUDIO || !sample)
+            return sample;
+        return nb_samples;
+    }
+    if (!sc->keyframe_count)
+        return sample;
+    i = mov_stss_search(sc, sample);
+    if (i == sc->keyframe_count)
+        return nb_samples;
+    return FFMIN(sc->keyframes[i] - (sc->keyframes[0] > 0), nb_samples);
+}
+
+static void mov_cursor_update_entry(AVStream *st, MOVSampleCursor *c)
+{
+    MOVStreamContext *sc = st->priv_data;
+    int64_t keyframe = mov_compact_prev_keyframe(st, c->sample);
+
+    c->entry.size         = mov_sample_size(sc, c->sample);
+    c->entry.min_distance = c->sample - FFMAX(keyframe, 0);
+    c->entry.flags        = keyframe == c->sample ? AVINDEX_KEYFRAME : 0;
+}
+
+static void mov_cursor_seek(AVStream *st, MOVSampleCursor *c, unsigned int sample)
+{
+    MOVStreamContext *sc = st->priv_data;
+    int64_t dts = sc->compact_start_dts;
+    int64_t pos;
+    unsigned int i, n = 0;
+
+    c->sample = sample;
+
+    c->stts_index = 0;
+    while (c->stts_index + 1 < sc->stts_count &&
+           sample - n >= sc->stts_data[c->stts_index].count) {
+        n   += sc->stts_data[c->stts_index].count;
+        dts += sc->stts_data[c->stts_index].count *
+               (int64_t)sc->stts_data[c->stts_index].duration;
+        c->stts_index++;
+    }
+    c->stts_sample = sample - n;
+    c->entry.timestamp = dts + c->stts_sample *
+                         (int64_t)sc->stts_data[c->stts_index].duration;
+
+    n = 0;
+    c->stsc_index = 0;
+    while (mov_stsc_index_valid(c->stsc_index, sc->stsc_count) &&
+           sample - n >= mov_get_stsc_samples(sc, c->stsc_index)) {
+        n += mov_get_stsc_samples(sc, c->stsc_index);
+        c->stsc_index++;
+    }
+    c->chunk        = sc->stsc_data[c->stsc_index].first - 1 +
+                      (sample - n) / sc->stsc_data[c->stsc_index].count;
+    c->chunk_sample = (sample - n) % sc->stsc_data[c->stsc_index].count;
+
+    pos = sc->chunk_offsets[c->chunk];
+    if (sc->stsz_sample_size > 0)
+        pos += c->chunk_sample * (int64_t)sc->stsz_sample_size;
+    else
+        for (i = sample - c->chunk_sample; i < sample; i++)
+            pos += (unsigned)sc->sample_sizes[i];
+    c->entry.pos = pos;
+
+    mov_cursor_update_entry(st, c);
+}
+
+static void mov_cursor_next(AVStream *st, MOVSampleCursor *c)
+{
+    MOVStreamContext *sc = st->priv_data;
+
+    c->entry.pos       += mov_sample_size(sc, c->sample);
+    c->entry.timestamp += sc->stts_data[c->stts_index].duration;
+    c->stts_sample++;
+    if (c->stts_index + 1 < sc->stts_count &&
+        c->stts_sample == sc->stts_data[c->stts_index].count) {
+        c->stts_sample = 0;
+        c->stts_index++;
+    }
+
+    c->sample++;
+    if (++c->chunk_sample == sc->stsc_data[c->stsc_index].count) {
+        c->chunk++;
+        c->chunk_sample = 0;
+        if (mov_stsc_index_valid(c->stsc_index, sc->stsc_count) &&
+            c->chunk + 1 == sc->stsc_data[c->stsc_index + 1].first)
+            c->stsc_index++;
+        c->entry.pos = sc->chunk_offsets[c->chunk];
+    }
+
+    mov_cursor_update_entry(st, c);
+}
+
+static int mov_sample_count(AVStream *st)
+{
+    MOVStreamContext *sc = st->priv_data;
+    return sc->compact_index ? sc->compact_sample_count : st->nb_index_entries;
+}
+
+/**
+ * Get a sample of the track, sample must be lower than mov_sample_count().
+ * With a compact index, the returned entry is only valid until the next
+ * call for the same track.
+ */
+static AVIndexEntry *mov_get_sample(AVStream *st, unsigned int sample)
+{
+    MOVStreamContext *sc = st->priv_data;
+
+    if (!sc->compact_index)
+        return &st->index_entries[sample];
+    if (sample == sc->cursor.sample + 1)
+        mov_cursor_next(st, &sc->cursor);
+    else if (sample != sc->cursor.sample)
+        mov_cursor_seek(st, &sc->cursor, sample);
+    return &sc->cursor.entry;
+}
+
+/**
+ * Equivalent of av_index_search_timestamp() over all the samples of a
+ * track with a compact index.
+ */
+static int mov_compact_search_timestamp(AVStream *st, int64_t wanted_timestamp,
+                                        int flags)
+{
+    MOVStreamContext *sc = st->priv_data;
+    unsigned int nb_samples = sc->compact_sample_count;
+    unsigned int i, sample = 0;
+    int64_t dts = sc->compact_start_dts;
+    int64_t a = -1, m;
+    int exact = 0;
+
+    for (i = 0; i < sc->stts_count && sample < nb_samples; i++) {
+        int64_t duration = sc->stts_data[i].duration;
+        unsigned int count = nb_samples - sample;
+
+        if (i + 1 < sc->stts_count)
+            count = FFMIN(count, sc->stts_data[i].count);
+        if (wanted_timestamp < dts)
+            break;
+        if (wanted_timestamp < dts + count * duration) {
+            a     = sample + (wanted_timestamp - dts) / duration;
+            exact = dts + (a - sample) * duration == wanted_timestamp;
+            break;
+        }
+        sample += count;
+        dts    += count * duration;
+        a       = sample - 1;
+    }
+
+    m = flags & AVSEEK_FLAG_BACKWARD ? a : a + !exact;
+    if (!(flags & AVSEEK_FLAG_ANY))
+        m = flags & AVSEEK_FLAG_BACKWARD ? mov_compact_prev_keyframe(st, m)
+                                         : mov_compact_next_keyframe(st, m);
+    return m < nb_samples ? m : -1;
+}
+
+static int mov_compact_index_usable(MOVContext *mov, AVStream *st)
+{
+    MOVStreamContext *sc = st->priv_data;
+    unsigned int i, stsc_index = 0;
+
+    if (!mov->compact_index ||
+        (st->codecpar->codec_type != AVMEDIA_TYPE_VIDEO &&
+         st->codecpar->codec_type != AVMEDIA_TYPE_AUDIO))
+        return 0;
+    /* mov_fix_index() and the rarer sample tables work on the full index */
+    if ((sc->elst_count && !mov->ignore_editlist && mov->advanced_editlist) ||
+        sc->stps_count || (sc->rap_group_count && sc->rap_group))
+        return 0;
+
+    for (i = 0; i < sc->stts_count; i++)
+        if (sc->stts_data[i].duration <= 0 ||
+            (!sc->stts_data[i].count && i + 1 < sc->stts_count))
+            return 0;
+    for (i = 0; i < sc->stsc_count; i++)
+        if (!sc->stsc_data[i].count ||
+            (i ? sc->stsc_data[i].first <= sc->stsc_data[i - 1].first
+               : sc->stsc_data[i].first != 1) ||
+            (sc->pseudo_stream_id != -1 &&
+             sc->stsc_data[i].id - 1 != sc->pseudo_stream_id))
+            return 0;
+    for (i = 1; i < sc->keyframe_count; i++)
+        if (sc->keyframes[i] <= sc->keyframes[i - 1])
+            return 0;
+
+    /* the sample size from stsz is ignored from the first chunk where it
+     * is too large, see mov_build_index() */
+    if (sc->sample_size > 0 && sc->sample_size < sc->stsz_sample_size) {
+        for (i = 0; i + 1 < sc->chunk_count; i++) {
+            while (mov_stsc_index_valid(stsc_index, sc->stsc_count) &&
+                   i + 1 == sc->stsc_data[stsc_index + 1].first)
+                stsc_index++;
+            if (sc->chunk_offsets[i + 1] > sc->chunk_offsets[i] &&
+                sc->stsc_data[stsc_index].count * (int64_t)sc->stsz_sample_size >
+                sc->chunk_offsets[i + 1] - sc->chunk_offsets[i])
+                return 0;
+        }
+    }
+
+    return 1;
+}
+
+static int mov_build_compact_index(MOVContext *mov, AVStream *st, int64_t start_dts)
+{
+    MOVStreamContext *sc = st->priv_data;
+    MOVSampleCursor *c = &sc->cursor;
+    int all_keyframes = sc->keyframe_absent ? st->codecpar->codec_type == AVMEDIA_TYPE_AUDIO
+                                            : !sc->keyframe_count;
+    uint64_t stream_size = 0;
+    int64_t total = 0, next_seek_point = INT64_MIN;
+    unsigned int i;
+
+    if (sc->stsz_sample_size > 0 && sc->stsz_sample_size < sc->sample_size) {
+        av_log(mov->fc, AV_LOG_WARNING, "STSZ sample size %d invalid (too small), ignoring\n", sc->stsz_sample_size);
+        sc->stsz_sample_size = sc->sample_size;
+    }
+
+    for (i = 0; i < sc->stsc_count; i++)
+        total += mov_get_stsc_samples(sc, i);
+
+    sc->compact_index        = 1;
+    sc->compact_start_dts    = start_dts;
+    sc->compact_sample_count = FFMIN(total, sc->sample_count);
+
+    for (i = 0; i < sc->compact_sample_count; i++) {
+        unsigned int sample_size = mov_sample_size(sc, i);
+
+        if (sample_size > 0x3FFFFFFF) {
+            av_log(mov->fc, AV_LOG_ERROR, "Sample size %u is too large\n", sample_size);
+            sc->compact_sample_count = i;
+            return AVERROR_INVALIDDATA;
+        }
+        if (i)
+            mov_cursor_next(st, c);
+        else
+            mov_cursor_seek(st, c, 0);
+
+        if ((c->entry.flags & AVINDEX_KEYFRAME) &&
+            (!all_keyframes || (!c->chunk_sample && c->entry.timestamp >= next_seek_point))) {
+            av_add_index_entry(st, c->entry.pos, c->entry.timestamp, c->entry.size,
+                               c->entry.min_distance, AVINDEX_KEYFRAME);
+            next_seek_point = c->entry.timestamp + sc->time_scale;
+        }
+        if (st->codecpar->codec_type == AVMEDIA_TYPE_VIDEO && i < 99)
+            ff_rfps_add_frame(mov->fc, st, c->entry.timestamp);
+        stream_size += sample_size;
+    }
+    if (total > sc->sample_count) {
+        av_log(mov->fc, AV_LOG_ERROR, "wrong sample count\n");
+        return AVERROR_INVALIDDATA;
+    }
+
+    if (st->duration > 0)
+        st->codecpar->bit_rate = stream_size*8*sc->time_scale/st->duration;
+    av_log(mov->fc, AV_LOG_DEBUG, "stream %d: compact index of %u samples, %d seek points\n",
+           st->index, sc->compact_sample_count, st->nb_index_entries);
+    return 0;
+}
+
+/**
+ * Replace the compact index of a track by the full index, for the code
+ * which edits st->index_entries.
+ */
+static int mov_expand_compact_index(AVStream *st)
+{
+    MOVStreamContext *sc = st->priv_data;
+    unsigned int i, nb_samples = sc->compact_sample_count;
+    AVIndexEntry *entries;
+    int ret;
+
+    if (!sc->compact_index)
+        return 0;
+    if (nb_samples >= UINT_MAX / sizeof(*entries))
+        return AVERROR(ENOMEM);
+    entries = av_malloc_array(FFMAX(nb_samples, 1), sizeof(*entries));
+    if (!entries)
+        return AVERROR(ENOMEM);
+    for (i = 0; i < nb_samples; i++)
+        entries[i] = *mov_get_sample(st, i);
+
+    av_free(st->index_entries);
+    st->index_entries                = entries;
+    st->nb_index_entries             = nb_samples;
+    st->index_entries_allocated_size = FFMAX(nb_samples, 1) * sizeof(*entries);
+    sc->compact_index = 0;
+
+    if ((ret = mov_expand_ctts(sc)) < 0)
+        return ret;
+    if (sc->ctts_data) {
+        sc->ctts_index  = FFMIN(sc->current_sample, sc->ctts_count);
+        sc->ctts_sample = 0;
+    }
+    return 0;
+}
+
 #define MAX_REORDER_DELAY 16
 static void mov_estimate_video_delay(MOVContext *c, AVStream* st) {
     MOVStreamContext *msc = st->priv_data;
@@ -3306,7 +3726,7 @@ static void mov_estimate_video_delay(MOVContext *c, AVStream* st) {
     if (st->codecpar->video_delay <= 0 && msc->ctts_data &&
         st->codecpar->codec_id == AV_CODEC_ID_H264) {
         st->codecpar->video_delay = 0;
-        for(ind = 0; ind < st->nb_index_entries && ctts_ind < msc->ctts_count; ++ind) {
+        for(ind = 0; ind < mov_sample_count(st) && ctts_ind < msc->ctts_count; ++ind) {
             if (buf_size == (MAX_REORDER_DELAY + 1)) {
                 // If circular buffer is full, then move the first element forward.
                 buf_start = (buf_start + 1) % buf_size;
@@ -3316,7 +3736,7 @@ static void mov_estimate_video_delay(MOVContext *c, AVStream* st) {
 
             // Point j to the last elem of the buffer and insert the current pts there.
             j = (buf_start + buf_size - 1) % buf_size;
-            pts_buf[j] = st->index_entries[ind].timestamp + msc->ctts_data[ctts_ind].duration;
+            pts_buf[j] = mov_get_sample(st, ind)->timestamp + msc->ctts_data[ctts_ind].duration;
 
             // The timestamps that are already in the sorted buffer, and are greater than the
             // current pts, are exactly the timestamps that need to be buffered to output PTS
@@ -3706,8 +4126,6 @@ static void mov_build_index(MOVContext *mov, AVStream *st)
     unsigned int stps_index = 0;
     unsigned int i, j;
     uint64_t stream_size = 0;
-    MOVStts *ctts_data_old = sc->ctts_data;
-    unsigned int ctts_count_old = sc->ctts_count;
 
     if (sc->elst_count) {
         int i, edit_start_index = 0, multiple_edits = 0;
@@ -3767,6 +4185,11 @@ static void mov_build_index(MOVContext *mov, AVStream *st)
 
         if (!sc->sample_count || st->nb_index_entries)
             return;
+        if (mov_compact_index_usable(mov, st)) {
+            if (mov_build_compact_index(mov, st, current_dts) >= 0)
+                mov_estimate_video_delay(mov, st);
+            return;
+        }
         if (sc->sample_count >= UINT_MAX / sizeof(*st->index_entries) - st->nb_index_entries)
             return;
         if (av_reallocp_array(&st->index_entries,
@@ -3777,30 +4200,8 @@ static void mov_build_index(MOVContext *mov, AVStream *st)
         }
         st->index_entries_allocated_size = (st->nb_index_entries + sc->sample_count) * sizeof(*st->index_entries);
 
-        if (ctts_data_old) {
-            // Expand ctts entries such that we have a 1-1 mapping with samples
-            if (sc->sample_count >= UINT_MAX / sizeof(*sc->ctts_data))
-                return;
-            sc->ctts_count = 0;
-            sc->ctts_allocated_size = 0;
-            sc->ctts_data = av_fast_realloc(NULL, &sc->ctts_allocated_size,
-                                    sc->sample_count * sizeof(*sc->ctts_data));
-            if (!sc->ctts_data) {
-                av_free(ctts_data_old);
-                return;
-            }
-
-            memset((uint8_t*)(sc->ctts_data), 0, sc->ctts_allocated_size);
-
-            for (i = 0; i < ctts_count_old &&
-                        sc->ctts_count < sc->sample_count; i++)
-                for (j = 0; j < ctts_data_old[i].count &&
-                            sc->ctts_count < sc->sample_count; j++)
-                    add_ctts_entry(&sc->ctts_data, &sc->ctts_count,
-                                   &sc->ctts_allocated_size, 1,
-                                   ctts_data_old[i].duration);
-            av_free(ctts_data_old);
-        }
+        if (mov_expand_ctts(sc) < 0)
+            return;
 
         for (i = 0; i < sc->chunk_count; i++) {
             int64_t next_offset = i+1 < sc->chunk_count ? sc->chunk_offsets[i+1] : INT64_MAX;
@@ -4236,11 +4637,13 @@ static int mov_read_trak(MOVContext *c, AVIOContext *pb, MOVAtom atom)
         && sc->time_scale == st->codecpar->sample_rate) {
             st->need_parsing = AVSTREAM_PARSE_FULL;
     }
-    /* Do not need those anymore. */
-    av_freep(&sc->chunk_offsets);
-    av_freep(&sc->sample_sizes);
-    av_freep(&sc->keyframes);
-    av_freep(&sc->stts_data);
+    /* Do not need those anymore, unless the samples are resolved from them. */
+    if (!sc->compact_index) {
+        av_freep(&sc->chunk_offsets);
+        av_freep(&sc->sample_sizes);
+        av_freep(&sc->keyframes);
+        av_freep(&sc->stts_data);
+    }
     av_freep(&sc->stps_data);
     av_freep(&sc->elst_data);
     av_freep(&sc->rap_group);
@@ -4647,7 +5050,7 @@ static int mov_read_trun(MOVContext *c, AVIOContext *pb, MOVAtom atom)
     int64_t dts, pts = AV_NOPTS_VALUE;
     int data_offset = 0;
     unsigned entries, first_sample_flags = frag->flags;
-    int flags, distance, i;
+    int flags, distance, i, ret;
     int64_t prev_dts = AV_NOPTS_VALUE;
     int next_frag_index = -1, index_entry_pos;
     size_t requested_size;
@@ -4668,6 +5071,8 @@ static int mov_read_trun(MOVContext *c, AVIOContext *pb, MOVAtom atom)
     sc = st->priv_data;
     if (sc->pseudo_stream_id+1 != frag->stsd_id && sc->pseudo_stream_id != -1)
         return 0;
+    if ((ret = mov_expand_compact_index(st)) < 0)
+        return ret;
 
     // Find the next frag_index index that has a valid index_entry for
     // the current track_id.
@@ -4713,6 +5118,12 @@ static int mov_read_trun(MOVContext *c, AVIOContext *pb, MOVAtom atom)
             dts = frag_stream_info->tfdt_dts - sc->time_offset;
             av_log(c->fc, AV_LOG_DEBUG, "found tfdt time %"PRId64
                     ", using it for dts\n", dts);
+        } else if (frag_stream_info->first_tfra_pts != AV_NOPTS_VALUE &&
+                   c->lazy_fragments) {
+            // the previous fragments may not have been read
+            dts = frag_stream_info->first_tfra_pts - sc->time_offset;
+            av_log(c->fc, AV_LOG_DEBUG, "found mfra time %"PRId64
+                    ", using it for dts\n", dts);
         } else {
             dts = sc->track_end - sc->time_offset;
             av_log(c->fc, AV_LOG_DEBUG, "found track end time %"PRId64
@@ -4906,6 +5317,38 @@ static int mov_read_trun(MOVContext *c, AVIOContext *pb, MOVAtom atom)
     return 0;
 }
 
+static int mov_read_sidx(MOVContext *c, AVIOContext *pb, MOVAtom atom);
+
+/* Read an sidx referenced by another one, which indexes its subsegments. */
+static int mov_read_sidx_reference(MOVContext *c, AVIOContext *pb,
+                                   int64_t offset, uint32_t size)
+{
+    int64_t pos = avio_tell(pb);
+    MOVAtom a;
+    int ret;
+
+    if (!(pb->seekable & AVIO_SEEKABLE_NORMAL) || c->atom_depth > 10) {
+        avpriv_request_sample(c->fc, "sidx reference_type 1");
+        return AVERROR_PATCHWELCOME;
+    }
+    if (avio_seek(pb, offset, SEEK_SET) != offset)
+        return AVERROR_INVALIDDATA;
+    a.size = avio_rb32(pb);
+    a.type = avio_rl32(pb);
+    if (a.type != MKTAG('s','i','d','x') || a.size < 8 || a.size > size) {
+        av_log(c->fc, AV_LOG_ERROR, "invalid sidx reference at 0x%"PRIx64"\n", offset);
+        return AVERROR_INVALIDDATA;
+    }
+    a.size -= 8;
+
+    c->atom_depth++;
+    ret = mov_read_sidx(c, pb, a);
+    c->atom_depth--;
+    if (avio_seek(pb, pos, SEEK_SET) != pos && ret >= 0)
+        ret = AVERROR_INVALIDDATA;
+    return ret;
+}
+
 static int mov_read_sidx(MOVContext *c, AVIOContext *pb, MOVAtom atom)
 {
     int64_t offset = avio_tell(pb) + atom.size, pts, timestamp;
@@ -4962,11 +5405,20 @@ static int mov_read_sidx(MOVContext *c, AVIOContext *pb, MOVAtom atom)
         MOVFragmentStreamInfo * frag_stream_info;
         uint32_t size = avio_rb32(pb);
         uint32_t duration = avio_rb32(pb);
+        avio_rb32(pb); // sap_flags
         if (size & 0x80000000) {
-            avpriv_request_sample(c->fc, "sidx reference_type 1");
-            return AVERROR_PATCHWELCOME;
+            int ret;
+            if (!c->lazy_fragments) {
+                avpriv_request_sample(c->fc, "sidx reference_type 1");
+                return AVERROR_PATCHWELCOME;
+            }
+            size &= 0x7FFFFFFF;
+            if ((ret = mov_read_sidx_reference(c, pb, offset, size)) < 0)
+                return ret;
+            offset += size;
+            pts += duration;
+            continue;
         }
-        avio_rb32(pb); // sap_flags
         timestamp = av_rescale_q(pts, st->time_base, timescale);
 
         index = update_frag_index(c, offset);
@@ -6761,6 +7213,8 @@ static void mov_read_chapters(AVFormatContext *s)
 
         sc = st->priv_data;
         cur_pos = avio_tell(sc->pb);
+        if (mov_expand_compact_index(st) < 0)
+            goto finish;
 
         if (st->codecpar->codec_type == AVMEDIA_TYPE_VIDEO) {
             st->disposition |= AV_DISPOSITION_ATTACHED_PIC | AV_DISPOSITION_TIMED_THUMBNAILS;
@@ -7237,14 +7691,17 @@ static int mov_read_header(AVFormatContext *s)
         for (i = 0; i < s->nb_streams; i++) {
             AVStream *st = s->streams[i];
             MOVStreamContext *sc = st->priv_data;
-            if (st->duration > 0) {
+            /* lazily read fragments only cover the samples read so far */
+            int64_t duration = mov->lazy_fragments && sc->duration_for_fps > 0 ?
+                               sc->duration_for_fps : st->duration;
+            if (duration > 0) {
                 if (sc->data_size > INT64_MAX / sc->time_scale / 8) {
                     av_log(s, AV_LOG_ERROR, "Overflow during bit rate calculation %"PRId64" * 8 * %d\n",
                            sc->data_size, sc->time_scale);
                     mov_read_close(s);
                     return AVERROR_INVALIDDATA;
                 }
-                st->codecpar->bit_rate = sc->data_size * 8 * sc->time_scale / st->duration;
+                st->codecpar->bit_rate = sc->data_size * 8 * sc->time_scale / duration;
             }
         }
     }
@@ -7340,6 +7797,24 @@ static int mov_read_header(AVFormatContext *s)
         if (mov->frag_index.item[i].moof_offset <= mov->fragment.moof_offset)
             mov->frag_index.item[i].headers_read = 1;
 
+    /* with lazy_fragments, read the last fragment for the track durations */
+    if (mov->lazy_fragments && mov->frag_index.complete &&
+        mov->frag_index.nb_items > 1 &&
+        !mov->frag_index.item[mov->frag_index.nb_items - 1].headers_read) {
+        int64_t pos = avio_tell(pb), next_root_atom = mov->next_root_atom;
+        int current = mov->frag_index.current;
+
+        err = mov_switch_root(s, -1, mov->frag_index.nb_items - 1);
+        mov->next_root_atom = next_root_atom;
+        mov->frag_index.current = current;
+        if (avio_seek(pb, pos, SEEK_SET) != pos)
+            err = AVERROR_INVALIDDATA;
+        if (err < 0 && err != AVERROR_EOF) {
+            mov_read_close(s);
+            return err;
+        }
+    }
+
     return 0;
 }
 
@@ -7351,8 +7826,8 @@ static AVIndexEntry *mov_find_next_sample(AVFormatContext *s, AVStream **st)
     for (i = 0; i < s->nb_streams; i++) {
         AVStream *avst = s->streams[i];
         MOVStreamContext *msc = avst->priv_data;
-        if (msc->pb && msc->current_sample < avst->nb_index_entries) {
-            AVIndexEntry *current_sample = &avst->index_entries[msc->current_sample];
+        if (msc->pb && msc->current_sample < mov_sample_count(avst)) {
+            AVIndexEntry *current_sample = mov_get_sample(avst, msc->current_sample);
             int64_t dts = av_rescale(current_sample->timestamp, AV_TIME_BASE, msc->time_scale);
             av_log(s, AV_LOG_TRACE, "stream %d, sample %d, dts %"PRId64"\n", i, msc->current_sample, dts);
             if (!sample || (!(s->pb->seekable & AVIO_SEEKABLE_NORMAL) && current_sample->pos < sample->pos) ||
@@ -7438,7 +7913,7 @@ static int mov_read_packet(AVFormatContext *s, AVPacket *pkt)
 {
     MOVContext *mov = s->priv_data;
     MOVStreamContext *sc;
-    AVIndexEntry *sample;
+    AVIndexEntry *sample, compact_sample;
     AVStream *st = NULL;
     int64_t current_index;
     int ret;
@@ -7453,6 +7928,11 @@ static int mov_read_packet(AVFormatContext *s, AVPacket *pkt)
         goto retry;
     }
     sc = st->priv_data;
+    if (sc->compact_index) {
+        /* the cursor entry changes when the next sample is resolved */
+        compact_sample = *sample;
+        sample = &compact_sample;
+    }
     /* must be done just before reading, to avoid infinite loop on sample */
     current_index = sc->current_index;
     mov_current_sample_inc(sc);
@@ -7527,8 +8007,8 @@ static int mov_read_packet(AVFormatContext *s, AVPacket *pkt)
             sc->ctts_sample = 0;
         }
     } else {
-        int64_t next_dts = (sc->current_sample < st->nb_index_entries) ?
-            st->index_entries[sc->current_sample].timestamp : st->duration;
+        int64_t next_dts = (sc->current_sample < mov_sample_count(st)) ?
+            mov_get_sample(st, sc->current_sample)->timestamp : st->duration;
         pkt->duration = next_dts - pkt->dts;
         pkt->pts = pkt->dts;
     }
@@ -7566,17 +8046,25 @@ static int mov_read_packet(AVFormatContext *s, AVPacket *pkt)
     return 0;
 }
 
-static int mov_seek_fragment(AVFormatContext *s, AVStream *st, int64_t timestamp)
+static int mov_seek_fragment(AVFormatContext *s, AVStream *st, int64_t timestamp, int flags)
 {
     MOVContext *mov = s->priv_data;
-    int index;
+    int index, ret;
 
     if (!mov->frag_index.complete)
         return 0;
 
-    index = search_frag_timestamp(&mov->frag_index, st, timestamp);
+    index = search_frag_timestamp(s, &mov->frag_index, st, timestamp);
     if (index < 0)
         index = 0;
+    /* the sample found by a forward seek may be in the next fragment */
+    if (mov->lazy_fragments && !(flags & AVSEEK_FLAG_BACKWARD) &&
+        index + 1 < mov->frag_index.nb_items &&
+        !mov->frag_index.item[index + 1].headers_read) {
+        ret = mov_switch_root(s, -1, index + 1);
+        if (ret < 0)
+            return ret;
+    }
     if (!mov->frag_index.item[index].headers_read)
         return mov_switch_root(s, -1, index);
     if (index + 1 < mov->frag_index.nb_items)
@@ -7595,13 +8083,16 @@ static int mov_seek_stream(AVFormatContext *s, AVStream *st, int64_t timestamp,
     // can search over the DTS timeline.
     timestamp -= (sc->min_corrected_pts + sc->dts_shift);
 
-    ret = mov_seek_fragment(s, st, timestamp);
+    ret = mov_seek_fragment(s, st, timestamp, flags);
     if (ret < 0)
         return ret;
 
-    sample = av_index_search_timestamp(st, timestamp, flags);
+    if (sc->compact_index)
+        sample = mov_compact_search_timestamp(st, timestamp, flags);
+    else
+        sample = av_index_search_timestamp(st, timestamp, flags);
     av_log(s, AV_LOG_TRACE, "stream %d, timestamp %"PRId64", sample %d\n", st->index, timestamp, sample);
-    if (sample < 0 && st->nb_index_entries && timestamp < st->index_entries[0].timestamp)
+    if (sample < 0 && mov_sample_count(st) && timestamp < mov_get_sample(st, 0)->timestamp)
         sample = 0;
     if (sample < 0) /* not sure what to do */
         return AVERROR_INVALIDDATA;
@@ -7642,7 +8133,7 @@ static int mov_read_seek(AVFormatContext *s, int stream_index, int64_t sample_ti
     MOVContext *mc = s->priv_data;
     AVStream *st;
     int sample;
-    int i;
+    int i, pass;
 
     if (stream_index >= s->nb_streams)
         return AVERROR_INVALIDDATA;
@@ -7654,19 +8145,32 @@ static int mov_read_seek(AVFormatContext *s, int stream_index, int64_t sample_ti
 
     if (mc->seek_individually) {
         /* adjust seek timestamp to found sample timestamp */
-        int64_t seek_timestamp = st->index_entries[sample].timestamp;
-
-        for (i = 0; i < s->nb_streams; i++) {
-            int64_t timestamp;
-            MOVStreamContext *sc = s->streams[i]->priv_data;
-            st = s->streams[i];
-            st->skip_samples = (sample_time <= 0) ? sc->start_pad : 0;
+        int64_t seek_timestamp = mov_get_sample(st, sample)->timestamp;
+        /* with lazy_fragments, a fragment read while seeking a stream can be
+         * inserted before the samples found for the previous streams, so seek
+         * a second time once all the needed fragments have been read */
+        int nb_passes = mc->lazy_fragments && mc->frag_index.complete ? 2 : 1;
+
+        for (pass = 0; pass < nb_passes; pass++) {
+            if (pass) {
+                st = s->streams[stream_index];
+                sample = mov_seek_stream(s, st, sample_time, flags);
+                if (sample < 0)
+                    return sample;
+                seek_timestamp = mov_get_sample(st, sample)->timestamp;
+            }
+            for (i = 0; i < s->nb_streams; i++) {
+                int64_t timestamp;
+                MOVStreamContext *sc = s->streams[i]->priv_data;
+                st = s->streams[i];
+                st->skip_samples = (sample_time <= 0) ? sc->start_pad : 0;
 
-            if (stream_index == i)
-                continue;
+                if (stream_index == i)
+                    continue;
 
-            timestamp = av_rescale_q(seek_timestamp, s->streams[stream_index]->time_base, st->time_base);
-            mov_seek_stream(s, st, timestamp, flags);
+                timestamp = av_rescale_q(seek_timestamp, s->streams[stream_index]->time_base, st->time_base);
+                mov_seek_stream(s, st, timestamp, flags);
+            }
         }
     } else {
         for (i = 0; i < s->nb_streams; i++) {
@@ -7706,8 +8210,16 @@ static const AVOption mov_options[] = {
         "Modify the AVIndex according to the editlists. Use this option to decode in the order specified by the edits.",
         OFFSET(advanced_editlist), AV_OPT_TYPE_BOOL, {.i64 = 1},
         0, 1, FLAGS},
+    {"compact_index",
+        "Resolve the samples of simple tracks from the sample tables instead of building a full index.",
+        OFFSET(compact_index), AV_OPT_TYPE_BOOL, {.i64 = 0},
+        0, 1, FLAGS},
     {"ignore_chapters", "", OFFSET(ignore_chapters), AV_OPT_TYPE_BOOL, {.i64 = 0},
         0, 1, FLAGS},
+    {"lazy_fragments",
+        "Index the fragments from the mfra atom and only read the fragments reached by playback or seeking.",
+        OFFSET(lazy_fragments), AV_OPT_TYPE_BOOL, {.i64 = 0},
+        0, 1, FLAGS},
     {"use_mfra_for",
         "use mfra for fragment timestamps",
         OFFSET(use_mfra_for), AV_OPT_TYPE_INT, {.i64 = FF_MOV_FLAG_MFRA_AUTO},
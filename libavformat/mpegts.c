@@ -150,6 +150,10 @@ struct MpegTSContext {
     int resync_size;
     int merge_pmt_versions;
 
+    /** comma-separated list of the PIDs to demux, all others are dropped */
+    char *keep_pids;
+    uint8_t keep_pid[NB_PID_MAX];
+
     /******************************************/
     /* private mpegts data */
     /* scan context */
@@ -161,6 +165,17 @@ struct MpegTSContext {
     /** filters for various streams specified by PMT + for the PAT and PMT */
     MpegTSFilter *pids[NB_PID_MAX];
     int current_pid;
+
+    /** PIDs whose packets are dropped before any parsing, built by
+     *  update_discard_pids() from the discard settings of the programs
+     *  and streams */
+    uint8_t discard_pids[NB_PID_MAX];
+    int discard_pids_valid;
+    /** discard settings of the streams and programs discard_pids was
+     *  built for */
+    int8_t *discard_state;
+    unsigned int discard_state_size;
+    int nb_discard_state;
 };
 
 #define MPEGTS_OPTIONS \
@@ -182,6 +197,8 @@ static const AVOption options[] = {
      {.i64 = 0}, 0, 1, 0 },
     {"skip_clear", "skip clearing programs", offsetof(MpegTSContext, skip_clear), AV_OPT_TYPE_BOOL,
      {.i64 = 0}, 0, 1, 0 },
+    {"keep_pids", "comma-separated list of the PIDs to demux, drop all others", offsetof(MpegTSContext, keep_pids), AV_OPT_TYPE_STRING,
+     {.str = NULL}, 0, 0, AV_OPT_FLAG_DECODING_PARAM },
     { NULL },
 };
 
@@ -288,12 +305,14 @@ static void clear_program(MpegTSContext *ts, unsigned int programid)
             ts->prg[i].nb_pids = 0;
             ts->prg[i].pmt_found = 0;
         }
+    ts->discard_pids_valid = 0;
 }
 
 static void clear_programs(MpegTSContext *ts)
 {
     av_freep(&ts->prg);
     ts->nb_prg = 0;
+    ts->discard_pids_valid = 0;
 }
 
 static void add_pat_entry(MpegTSContext *ts, unsigned int programid)
@@ -308,6 +327,7 @@ static void add_pat_entry(MpegTSContext *ts, unsigned int programid)
     p->nb_pids = 0;
     p->pmt_found = 0;
     ts->nb_prg++;
+    ts->discard_pids_valid = 0;
 }
 
 static void add_pid_to_pmt(MpegTSContext *ts, unsigned int programid,
@@ -326,6 +346,7 @@ static void add_pid_to_pmt(MpegTSContext *ts, unsigned int programid,
             return;
 
     p->pids[p->nb_pids++] = pid;
+    ts->discard_pids_valid = 0;
 }
 
 static void set_pmt_found(MpegTSContext *ts, unsigned int programid)
@@ -337,9 +358,10 @@ static void set_pmt_found(MpegTSContext *ts, unsigned int programid)
     p->pmt_found = 1;
 }
 
-static void update_av_program_info(AVFormatContext *s, unsigned int programid,
+static void update_av_program_info(MpegTSContext *ts, unsigned int programid,
                                    unsigned int pid, int version)
 {
+    AVFormatContext *s = ts->stream;
     int i;
     for (i = 0; i < s->nb_programs; i++) {
         AVProgram *program = s->programs[i];
@@ -348,6 +370,8 @@ static void update_av_program_info(AVFormatContext *s, unsigned int programid,
                 old_version = program->pmt_version;
             program->pcr_pid = pid;
             program->pmt_version = version;
+            if (old_pcr_pid != pid)
+                ts->discard_pids_valid = 0;
 
             if (old_version != -1 && old_version != version) {
                 av_log(s, AV_LOG_VERBOSE,
@@ -359,46 +383,105 @@ static void update_av_program_info(AVFormatContext *s, unsigned int programid,
     }
 }
 
+static void pmt_cb(MpegTSFilter *filter, const uint8_t *section, int section_len);
+
 /**
- * @brief discard_pid() decides if the pid is to be discarded according
- *                      to caller's programs selection
- * @param ts    : - TS context
- * @param pid   : - pid
- * @return 1 if the pid is only comprised in programs that have .discard=AVDISCARD_ALL
- *         0 otherwise
+ * Build the table of the PIDs which handle_packet() drops right away:
+ * those only comprised in programs that have .discard=AVDISCARD_ALL,
+ * those of PES streams whose AVStreams are all discarded, and with
+ * keep_pids those not listed in it.
  */
-static int discard_pid(MpegTSContext *ts, unsigned int pid)
+static void update_discard_pids(MpegTSContext *ts)
 {
-    int i, j, k;
-    int used = 0, discarded = 0;
-    struct Program *p;
+    AVFormatContext *s = ts->stream;
+    int i, j, k, n = s->nb_streams + s->nb_programs;
+
+    memset(ts->discard_pids, 0, sizeof(ts->discard_pids));
 
     /* If none of the programs have .discard=AVDISCARD_ALL then there's
-     * no way we have to discard this packet */
-    for (k = 0; k < ts->stream->nb_programs; k++)
-        if (ts->stream->programs[k]->discard == AVDISCARD_ALL)
+     * no way we have to discard a pid because of its programs */
+    for (k = 0; k < s->nb_programs; k++)
+        if (s->programs[k]->discard == AVDISCARD_ALL)
             break;
-    if (k == ts->stream->nb_programs)
-        return 0;
+    if (k < s->nb_programs) {
+        /* bit 0: used by a program, bit 1: used by a discarded program */
+        for (i = 0; i < ts->nb_prg; i++) {
+            struct Program *p = &ts->prg[i];
+            int flags = 0;
+            for (k = 0; k < s->nb_programs; k++)
+                if (s->programs[k]->id == p->id)
+                    flags |= s->programs[k]->discard == AVDISCARD_ALL ? 2 : 1;
+            for (j = 0; j < p->nb_pids; j++)
+                ts->discard_pids[p->pids[j]] |= flags;
+        }
+        for (i = 0; i < NB_PID_MAX; i++)
+            ts->discard_pids[i] = ts->discard_pids[i] == 2;
+    }
 
-    for (i = 0; i < ts->nb_prg; i++) {
-        p = &ts->prg[i];
-        for (j = 0; j < p->nb_pids; j++) {
-            if (p->pids[j] != pid)
-                continue;
-            // is program with id p->id set to be discarded?
-            for (k = 0; k < ts->stream->nb_programs; k++) {
-                if (ts->stream->programs[k]->id == p->id) {
-                    if (ts->stream->programs[k]->discard == AVDISCARD_ALL)
-                        discarded++;
-                    else
-                        used++;
-                }
-            }
+    for (i = 0; i < NB_PID_MAX; i++) {
+        MpegTSFilter *tss = ts->pids[i];
+        if (tss && tss->type == MPEGTS_PES) {
+            PESContext *pes = tss->u.pes_filter.opaque;
+            if (pes->st && pes->st->discard == AVDISCARD_ALL &&
+                (!pes->sub_st || pes->sub_st->discard == AVDISCARD_ALL))
+                ts->discard_pids[i] = 1;
         }
     }
+    /* keep the PCR of the programs still in use, which may be carried by
+     * the PID of a discarded stream */
+    for (i = 0; i < s->nb_programs; i++) {
+        AVProgram *program = s->programs[i];
+        if (program->discard != AVDISCARD_ALL && program->pcr_pid >= 0)
+            ts->discard_pids[program->pcr_pid] = 0;
+    }
+    /* the PAT, SDT and PMTs are still needed to find the streams */
+    if (ts->keep_pids) {
+        for (i = 0; i < NB_PID_MAX; i++) {
+            MpegTSFilter *tss = ts->pids[i];
+            if (!ts->keep_pid[i] && i != SDT_PID &&
+                !(tss && tss->type == MPEGTS_SECTION &&
+                  tss->u.section_filter.section_cb == pmt_cb))
+                ts->discard_pids[i] = 1;
+        }
+    }
+    ts->discard_pids[0] = 0;
+
+    av_fast_malloc(&ts->discard_state, &ts->discard_state_size, n);
+    if (ts->discard_state || !n) {
+        for (i = 0; i < s->nb_streams; i++)
+            ts->discard_state[i] = s->streams[i]->discard;
+        for (i = 0; i < s->nb_programs; i++)
+            ts->discard_state[s->nb_streams + i] = s->programs[i]->discard;
+        ts->nb_discard_state = n;
+    } else {
+        ts->nb_discard_state = -1;
+    }
+    ts->discard_pids_valid = 1;
+}
+
+/**
+ * Make sure the table of discarded PIDs matches the current discard
+ * settings, which the user may change between two reads.
+ */
+static void check_discard_pids(MpegTSContext *ts)
+{
+    AVFormatContext *s = ts->stream;
+    int i;
 
-    return !used && discarded;
+    if (ts->discard_pids_valid &&
+        ts->nb_discard_state == s->nb_streams + s->nb_programs) {
+        for (i = 0; i < s->nb_streams; i++)
+            if (ts->discard_state[i] != s->streams[i]->discard)
+                break;
+        if (i == s->nb_streams) {
+            for (i = 0; i < s->nb_programs; i++)
+                if (ts->discard_state[s->nb_streams + i] != s->programs[i]->discard)
+                    break;
+            if (i == s->nb_programs)
+                return;
+        }
+    }
+    update_discard_pids(ts);
 }
 
 /**
@@ -484,6 +567,7 @@ static MpegTSFilter *mpegts_open_filter(MpegTSContext *ts, unsigned int pid,
     if (!filter)
         return NULL;
     ts->pids[pid] = filter;
+    ts->discard_pids_valid = 0;
 
     filter->type    = type;
     filter->pid     = pid;
@@ -559,6 +643,7 @@ static void mpegts_close_filter(MpegTSContext *ts, MpegTSFilter *filter)
 
     av_free(filter);
     ts->pids[pid] = NULL;
+    ts->discard_pids_valid = 0;
 }
 
 static int analyze(const uint8_t *buf, int size, int packet_size,
@@ -2125,7 +2210,7 @@ static void pmt_cb(MpegTSFilter *filter, const uint8_t *section, int section_len
         return;
     pcr_pid &= 0x1fff;
     add_pid_to_pmt(ts, h->id, pcr_pid);
-    update_av_program_info(ts->stream, h->id, pcr_pid, h->version);
+    update_av_program_info(ts, h->id, pcr_pid, h->version);
 
     av_log(ts->stream, AV_LOG_TRACE, "pcr_pid=0x%x\n", pcr_pid);
 
@@ -2462,7 +2547,9 @@ static int handle_packet(MpegTSContext *ts, const uint8_t *packet)
     int64_t pos;
 
     pid = AV_RB16(packet + 1) & 0x1fff;
-    if (pid && discard_pid(ts, pid))
+    if (!ts->discard_pids_valid)
+        update_discard_pids(ts);
+    if (ts->discard_pids[pid])
         return 0;
     is_start = packet[1] & 0x40;
     tss = ts->pids[pid];
@@ -2691,6 +2778,30 @@ static void finished_reading_packet(AVFormatContext *s, int raw_packet_size)
         avio_skip(pb, skip);
 }
 
+/**
+ * Skip the packets of discarded PIDs directly in the I/O buffer, without
+ * going through read_packet() and handle_packet().
+ * @return the number of packets skipped
+ */
+static int64_t skip_discarded_packets(MpegTSContext *ts, int64_t nb_packets)
+{
+    AVIOContext *pb = ts->stream->pb;
+    const uint8_t *p = pb->buf_ptr;
+    int64_t n = 0;
+
+    if (pb->write_flag)
+        return 0;
+    if (!ts->discard_pids_valid)
+        update_discard_pids(ts);
+    while (pb->buf_end - p >= TS_PACKET_SIZE && p[0] == 0x47 &&
+           ts->discard_pids[AV_RB16(p + 1) & 0x1fff] && n < nb_packets) {
+        p += TS_PACKET_SIZE;
+        n++;
+    }
+    pb->buf_ptr = (uint8_t *)p;
+    return n;
+}
+
 static int handle_packets(MpegTSContext *ts, int64_t nb_packets)
 {
     AVFormatContext *s = ts->stream;
@@ -2719,6 +2830,8 @@ static int handle_packets(MpegTSContext *ts, int64_t nb_packets)
         }
     }
 
+    check_discard_pids(ts);
+
     ts->stop_parse = 0;
     packet_num = 0;
     memset(packet + TS_PACKET_SIZE, 0, AV_INPUT_BUFFER_PADDING_SIZE);
@@ -2732,6 +2845,14 @@ static int handle_packets(MpegTSContext *ts, int64_t nb_packets)
         if (ts->stop_parse > 0)
             break;
 
+        if (ts->raw_packet_size == TS_PACKET_SIZE) {
+            packet_num += skip_discarded_packets(ts, nb_packets ? nb_packets - packet_num : INT64_MAX);
+            if (nb_packets != 0 && packet_num >= nb_packets) {
+                ret = AVERROR(EAGAIN);
+                break;
+            }
+        }
+
         ret = read_packet(s, packet, ts->raw_packet_size, &data);
         if (ret != 0)
             break;
@@ -2822,6 +2943,23 @@ static void seek_back(AVFormatContext *s, AVIOContext *pb, int64_t pos) {
         av_log(s, (pb->seekable & AVIO_SEEKABLE_NORMAL) ? AV_LOG_ERROR : AV_LOG_INFO, "Unable to seek back to the start\n");
 }
 
+static int parse_keep_pids(AVFormatContext *s, MpegTSContext *ts)
+{
+    const char *p = ts->keep_pids;
+
+    while (*p) {
+        char *end;
+        long pid = strtol(p, &end, 0);
+        if (end == p || pid < 0 || pid >= NB_PID_MAX || (*end && *end != ',')) {
+            av_log(s, AV_LOG_ERROR, "Invalid PID list '%s'\n", ts->keep_pids);
+            return AVERROR(EINVAL);
+        }
+        ts->keep_pid[pid] = 1;
+        p = *end ? end + 1 : end;
+    }
+    return 0;
+}
+
 static int mpegts_read_header(AVFormatContext *s)
 {
     MpegTSContext *ts = s->priv_data;
@@ -2832,6 +2970,12 @@ static int mpegts_read_header(AVFormatContext *s)
 
     s->internal->prefer_codec_framerate = 1;
 
+    if (ts->keep_pids) {
+        int ret = parse_keep_pids(s, ts);
+        if (ret < 0)
+            return ret;
+    }
+
     if (ffio_ensure_seekback(pb, probesize) < 0)
         av_log(s, AV_LOG_WARNING, "Failed to allocate buffers for seekback\n");
 
@@ -3018,6 +3162,7 @@ static void mpegts_free(MpegTSContext *ts)
     for (i = 0; i < NB_PID_MAX; i++)
         if (ts->pids[i])
             mpegts_close_filter(ts, ts->pids[i]);
+    av_freep(&ts->discard_state);
 }
 
 static int mpegts_read_close(AVFormatContext *s)
@@ -3124,6 +3269,7 @@ int avpriv_mpegts_parse_packet(MpegTSContext *ts, AVPacket *pkt,
 
     len1 = len;
     ts->pkt = pkt;
+    check_discard_pids(ts);
     for (;;) {
         ts->stop_parse = 0;
         if (len < TS_PACKET_SIZE)
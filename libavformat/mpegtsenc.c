@@ -1412,17 +1412,18 @@ static void mpegts_write_pes(AVFormatContext *s, AVStream *st,
             }
         }
 
+        mpegts_prefix_m2ts_header(s);
+        /* write the payload from the packet instead of copying it into buf */
+        avio_write(s->pb, buf, TS_PACKET_SIZE - len);
         if (is_dvb_subtitle && payload_size == len) {
-            memcpy(buf + TS_PACKET_SIZE - len, payload, len - 1);
-            buf[TS_PACKET_SIZE - 1] = 0xff; /* end_of_PES_data_field_marker: an 8-bit field with fixed contents 0xff for DVB subtitle */
+            avio_write(s->pb, payload, len - 1);
+            avio_w8(s->pb, 0xff); /* end_of_PES_data_field_marker: an 8-bit field with fixed contents 0xff for DVB subtitle */
         } else {
-            memcpy(buf + TS_PACKET_SIZE - len, payload, len);
+            avio_write(s->pb, payload, len);
         }
 
         payload      += len;
         payload_size -= len;
-        mpegts_prefix_m2ts_header(s);
-        avio_write(s->pb, buf, TS_PACKET_SIZE);
     }
     ts_st->prev_payload_key = key;
 }
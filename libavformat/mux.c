@@ -240,6 +240,14 @@ static int validate_codec_tag(AVFormatContext *s, AVStream *st)
 }
 
 
+/* streams whose queue is checked against max_interleave_delta */
+static int is_delta_stream(const AVStream *st)
+{
+    return st->codecpar->codec_type != AVMEDIA_TYPE_ATTACHMENT &&
+           st->codecpar->codec_id   != AV_CODEC_ID_VP8 &&
+           st->codecpar->codec_id   != AV_CODEC_ID_VP9;
+}
+
 static int init_muxer(AVFormatContext *s, AVDictionary **options)
 {
     int ret = 0, i;
@@ -382,6 +390,8 @@ FF_ENABLE_DEPRECATION_WARNINGS
 
         if (par->codec_type != AVMEDIA_TYPE_ATTACHMENT)
             s->internal->nb_interleaved_streams++;
+        if (is_delta_stream(st))
+            s->internal->nb_delta_streams++;
     }
 
     if (!s->priv_data && of->priv_data_size > 0) {
@@ -916,17 +926,114 @@ int av_write_frame(AVFormatContext *s, AVPacket *pkt)
 
 #define CHUNK_START 0x1000
 
+/**
+ * Entry of the interleaving queue of a stream.
+ */
+typedef struct InterleaveEntry {
+    AVPacketList list;  ///< must be first, the queues link these
+    int64_t seq;        ///< order in which the packet was queued
+} InterleaveEntry;
+
+/**
+ * Return whether the first queued packet of stream a goes before the one
+ * of stream b.
+ */
+static int interleave_before(AVFormatContext *s, const AVStream *a,
+                             const AVStream *b)
+{
+    InterleaveEntry *ea = (InterleaveEntry *)a->internal->first_in_packet_buffer;
+    InterleaveEntry *eb = (InterleaveEntry *)b->internal->first_in_packet_buffer;
+
+    if (a->internal->interleave_front || b->internal->interleave_front)
+        return a->internal->interleave_front > b->internal->interleave_front;
+
+    /* A packet inserted into a sorted list goes after all the packets
+     * which compare() does not put after it. */
+    if (ea->seq < eb->seq)
+        return !s->internal->interleave_compare(s, &ea->list.pkt, &eb->list.pkt);
+    return s->internal->interleave_compare(s, &eb->list.pkt, &ea->list.pkt);
+}
+
+static void interleave_heap_set(AVFormatContext *s, int pos, int stream_index)
+{
+    s->internal->interleave_heap[pos] = stream_index;
+    s->streams[stream_index]->internal->interleave_heap_pos = pos;
+}
+
+static void interleave_heap_up(AVFormatContext *s, int pos)
+{
+    int *heap = s->internal->interleave_heap;
+    int stream_index = heap[pos];
+
+    while (pos > 0) {
+        int parent = (pos - 1) >> 1;
+        if (!interleave_before(s, s->streams[stream_index], s->streams[heap[parent]]))
+            break;
+        interleave_heap_set(s, pos, heap[parent]);
+        pos = parent;
+    }
+    interleave_heap_set(s, pos, stream_index);
+}
+
+static void interleave_heap_down(AVFormatContext *s, int pos)
+{
+    int *heap = s->internal->interleave_heap;
+    int stream_index = heap[pos];
+
+    for (;;) {
+        int child = 2 * pos + 1;
+        if (child >= s->internal->nb_queued_streams)
+            break;
+        if (child + 1 < s->internal->nb_queued_streams &&
+            interleave_before(s, s->streams[heap[child + 1]], s->streams[heap[child]]))
+            child++;
+        if (!interleave_before(s, s->streams[heap[child]], s->streams[stream_index]))
+            break;
+        interleave_heap_set(s, pos, heap[child]);
+        pos = child;
+    }
+    interleave_heap_set(s, pos, stream_index);
+}
+
+/**
+ * Update the ordering of the stream after its first queued packet changed.
+ */
+static void interleave_update_front(AVFormatContext *s, AVStream *st)
+{
+    int chunked = s->max_chunk_size || s->max_chunk_duration;
+    AVPacketList *first = st->internal->first_in_packet_buffer;
+
+    /* The rest of a chunk directly follows the previous packet of its
+     * stream, which was the first packet of all the queues when it was
+     * output, or is inserted first if it was output already. */
+    if (chunked && !(first->pkt.flags & CHUNK_START))
+        st->internal->interleave_front = ++s->internal->interleave_seq;
+    else
+        st->internal->interleave_front = 0;
+}
+
 int ff_interleave_add_packet(AVFormatContext *s, AVPacket *pkt,
                              int (*compare)(AVFormatContext *, AVPacket *, AVPacket *))
 {
     int ret;
-    AVPacketList **next_point, *this_pktl;
+    AVFormatInternal *si = s->internal;
+    InterleaveEntry *entry;
+    AVPacketList *this_pktl;
     AVStream *st   = s->streams[pkt->stream_index];
     int chunked    = s->max_chunk_size || s->max_chunk_duration;
+    int64_t dts;
+    int *heap;
+
+    heap = av_fast_realloc(si->interleave_heap, &si->interleave_heap_size,
+                           s->nb_streams * sizeof(*heap));
+    if (!heap)
+        return AVERROR(ENOMEM);
+    si->interleave_heap = heap;
 
-    this_pktl      = av_mallocz(sizeof(AVPacketList));
-    if (!this_pktl)
+    entry          = av_mallocz(sizeof(*entry));
+    if (!entry)
         return AVERROR(ENOMEM);
+    this_pktl      = &entry->list;
     if ((pkt->flags & AV_PKT_FLAG_UNCODED_FRAME)) {
         av_assert0(pkt->size == UNCODED_FRAME_PACKET_SIZE);
         av_assert0(((AVFrame *)pkt->data)->buf);
@@ -934,19 +1041,17 @@ int ff_interleave_add_packet(AVFormatContext *s, AVPacket *pkt,
         pkt->buf = NULL;
         pkt->side_data = NULL;
         pkt->side_data_elems = 0;
+    } else if (pkt->buf) {
+        /* the packet is owned by the interleaver, take over its reference */
+        av_packet_move_ref(&this_pktl->pkt, pkt);
+        pkt = &this_pktl->pkt;
     } else {
         if ((ret = av_packet_ref(&this_pktl->pkt, pkt)) < 0) {
-            av_free(this_pktl);
+            av_free(entry);
             return ret;
         }
     }
 
-    if (s->streams[pkt->stream_index]->last_in_packet_buffer) {
-        next_point = &(st->last_in_packet_buffer->next);
-    } else {
-        next_point = &s->internal->packet_buffer;
-    }
-
     if (chunked) {
         uint64_t max= av_rescale_q_rnd(s->max_chunk_duration, AV_TIME_BASE_Q, st->time_base, AV_ROUND_UP);
         st->interleaver_chunk_size     += pkt->size;
@@ -964,36 +1069,102 @@ int ff_interleave_add_packet(AVFormatContext *s, AVPacket *pkt,
                 st->interleaver_chunk_duration = 0;
         }
     }
-    if (*next_point) {
-        if (chunked && !(this_pktl->pkt.flags & CHUNK_START))
-            goto next_non_null;
-
-        if (compare(s, &s->internal->packet_buffer_end->pkt, pkt)) {
-            while (   *next_point
-                   && ((chunked && !((*next_point)->pkt.flags&CHUNK_START))
-                       || !compare(s, &(*next_point)->pkt, pkt)))
-                next_point = &(*next_point)->next;
-            if (*next_point)
-                goto next_non_null;
-        } else {
-            next_point = &(s->internal->packet_buffer_end->next);
-        }
+
+    entry->seq              = ++si->interleave_seq;
+    si->interleave_compare  = compare;
+    dts = av_rescale_q(this_pktl->pkt.dts, st->time_base, AV_TIME_BASE_Q);
+
+    if (!si->nb_queued_streams ||
+        (si->max_dts_stream >= 0 && dts > si->max_dts)) {
+        si->max_dts_stream = st->index;
+        si->max_dts        = dts;
     }
-    av_assert1(!*next_point);
 
-    s->internal->packet_buffer_end = this_pktl;
-next_non_null:
+    if (st->last_in_packet_buffer) {
+        /* the first packet of the stream, and so its ordering, is unchanged */
+        st->last_in_packet_buffer->next = this_pktl;
+    } else {
+        st->internal->first_in_packet_buffer = this_pktl;
+        interleave_update_front(s, st);
+        if (is_delta_stream(st))
+            si->nb_queued_delta_streams++;
+        interleave_heap_set(s, si->nb_queued_streams, st->index);
+        interleave_heap_up(s, si->nb_queued_streams++);
+    }
+    st->last_in_packet_buffer = this_pktl;
 
-    this_pktl->next = *next_point;
+    if (pkt != &this_pktl->pkt)
+        av_packet_unref(pkt);
 
-    s->streams[pkt->stream_index]->last_in_packet_buffer =
-        *next_point                                      = this_pktl;
+    return 0;
+}
 
-    av_packet_unref(pkt);
+AVPacket *ff_interleave_queue_peek(AVFormatContext *s)
+{
+    AVStream *st;
+
+    if (!s->internal->nb_queued_streams)
+        return NULL;
+    st = s->streams[s->internal->interleave_heap[0]];
+    return &st->internal->first_in_packet_buffer->pkt;
+}
+
+int ff_interleave_queue_get(AVFormatContext *s, AVPacket *pkt)
+{
+    AVFormatInternal *si = s->internal;
+    AVPacketList *pktl;
+    AVStream *st;
+
+    if (!si->nb_queued_streams)
+        return AVERROR(ENOENT);
+
+    st   = s->streams[si->interleave_heap[0]];
+    pktl = st->internal->first_in_packet_buffer;
+    *pkt = pktl->pkt;
+    st->internal->first_in_packet_buffer = pktl->next;
+    av_freep(&pktl);
+
+    if (st->internal->first_in_packet_buffer) {
+        interleave_update_front(s, st);
+    } else {
+        st->last_in_packet_buffer = NULL;
+        if (is_delta_stream(st))
+            si->nb_queued_delta_streams--;
+        if (si->max_dts_stream == st->index)
+            si->max_dts_stream = -1;
+        if (!--si->nb_queued_streams)
+            return 0;
+        interleave_heap_set(s, 0, si->interleave_heap[si->nb_queued_streams]);
+    }
+    interleave_heap_down(s, 0);
 
     return 0;
 }
 
+void ff_interleave_queue_free(AVFormatContext *s)
+{
+    int i;
+
+    for (i = 0; i < s->nb_streams; i++) {
+        AVStream *st = s->streams[i];
+        AVPacketList *pktl = st->internal ? st->internal->first_in_packet_buffer : NULL;
+
+        while (pktl) {
+            AVPacketList *next = pktl->next;
+            av_packet_unref(&pktl->pkt);
+            av_freep(&pktl);
+            pktl = next;
+        }
+        if (st->internal)
+            st->internal->first_in_packet_buffer = NULL;
+        st->last_in_packet_buffer = NULL;
+    }
+    s->internal->nb_queued_streams       =
+    s->internal->nb_queued_delta_streams = 0;
+    av_freep(&s->internal->interleave_heap);
+    s->internal->interleave_heap_size = 0;
+}
+
 static int interleave_compare_dts(AVFormatContext *s, AVPacket *next,
                                   AVPacket *pkt)
 {
@@ -1020,9 +1191,9 @@ static int interleave_compare_dts(AVFormatContext *s, AVPacket *next,
 int ff_interleave_packet_per_dts(AVFormatContext *s, AVPacket *out,
                                  AVPacket *pkt, int flush)
 {
-    AVPacketList *pktl;
-    int stream_count = 0;
-    int noninterleaved_count = 0;
+    AVFormatInternal *si = s->internal;
+    AVPacket *top_pkt;
+    int stream_count, noninterleaved_count;
     int i, ret;
     int eof = flush;
 
@@ -1031,42 +1202,41 @@ int ff_interleave_packet_per_dts(AVFormatContext *s, AVPacket *out,
             return ret;
     }
 
-    for (i = 0; i < s->nb_streams; i++) {
-        if (s->streams[i]->last_in_packet_buffer) {
-            ++stream_count;
-        } else if (s->streams[i]->codecpar->codec_type != AVMEDIA_TYPE_ATTACHMENT &&
-                   s->streams[i]->codecpar->codec_id != AV_CODEC_ID_VP8 &&
-                   s->streams[i]->codecpar->codec_id != AV_CODEC_ID_VP9) {
-            ++noninterleaved_count;
-        }
-    }
+    stream_count         = si->nb_queued_streams;
+    noninterleaved_count = si->nb_delta_streams - si->nb_queued_delta_streams;
+    top_pkt              = ff_interleave_queue_peek(s);
 
-    if (s->internal->nb_interleaved_streams == stream_count)
+    if (si->nb_interleaved_streams == stream_count)
         flush = 1;
 
     if (s->max_interleave_delta > 0 &&
-        s->internal->packet_buffer &&
+        top_pkt &&
         !flush &&
-        s->internal->nb_interleaved_streams == stream_count+noninterleaved_count
+        si->nb_interleaved_streams == stream_count+noninterleaved_count
     ) {
-        AVPacket *top_pkt = &s->internal->packet_buffer->pkt;
-        int64_t delta_dts = INT64_MIN;
+        int64_t delta_dts;
         int64_t top_dts = av_rescale_q(top_pkt->dts,
                                        s->streams[top_pkt->stream_index]->time_base,
                                        AV_TIME_BASE_Q);
 
-        for (i = 0; i < s->nb_streams; i++) {
-            int64_t last_dts;
-            const AVPacketList *last = s->streams[i]->last_in_packet_buffer;
+        if (si->max_dts_stream < 0) {
+            for (i = 0; i < s->nb_streams; i++) {
+                int64_t last_dts;
+                const AVPacketList *last = s->streams[i]->last_in_packet_buffer;
 
-            if (!last)
-                continue;
+                if (!last)
+                    continue;
 
-            last_dts = av_rescale_q(last->pkt.dts,
-                                    s->streams[i]->time_base,
-                                    AV_TIME_BASE_Q);
-            delta_dts = FFMAX(delta_dts, last_dts - top_dts);
+                last_dts = av_rescale_q(last->pkt.dts,
+                                        s->streams[i]->time_base,
+                                        AV_TIME_BASE_Q);
+                if (si->max_dts_stream < 0 || last_dts > si->max_dts) {
+                    si->max_dts_stream = i;
+                    si->max_dts        = last_dts;
+                }
+            }
         }
+        delta_dts = si->max_dts - top_dts;
 
         if (delta_dts > s->max_interleave_delta) {
             av_log(s, AV_LOG_DEBUG,
@@ -1077,58 +1247,33 @@ int ff_interleave_packet_per_dts(AVFormatContext *s, AVPacket *out,
         }
     }
 
-    if (s->internal->packet_buffer &&
+    if (top_pkt &&
         eof &&
         (s->flags & AVFMT_FLAG_SHORTEST) &&
-        s->internal->shortest_end == AV_NOPTS_VALUE) {
-        AVPacket *top_pkt = &s->internal->packet_buffer->pkt;
-
-        s->internal->shortest_end = av_rescale_q(top_pkt->dts,
+        si->shortest_end == AV_NOPTS_VALUE) {
+        si->shortest_end = av_rescale_q(top_pkt->dts,
                                        s->streams[top_pkt->stream_index]->time_base,
                                        AV_TIME_BASE_Q);
     }
 
-    if (s->internal->shortest_end != AV_NOPTS_VALUE) {
-        while (s->internal->packet_buffer) {
-            AVPacket *top_pkt = &s->internal->packet_buffer->pkt;
-            AVStream *st;
+    if (si->shortest_end != AV_NOPTS_VALUE) {
+        while ((top_pkt = ff_interleave_queue_peek(s))) {
+            AVPacket drop_pkt;
             int64_t top_dts = av_rescale_q(top_pkt->dts,
                                         s->streams[top_pkt->stream_index]->time_base,
                                         AV_TIME_BASE_Q);
 
-            if (s->internal->shortest_end + 1 >= top_dts)
+            if (si->shortest_end + 1 >= top_dts)
                 break;
 
-            pktl = s->internal->packet_buffer;
-            st   = s->streams[pktl->pkt.stream_index];
-
-            s->internal->packet_buffer = pktl->next;
-            if (!s->internal->packet_buffer)
-                s->internal->packet_buffer_end = NULL;
-
-            if (st->last_in_packet_buffer == pktl)
-                st->last_in_packet_buffer = NULL;
-
-            av_packet_unref(&pktl->pkt);
-            av_freep(&pktl);
+            ff_interleave_queue_get(s, &drop_pkt);
+            av_packet_unref(&drop_pkt);
             flush = 0;
         }
     }
 
     if (stream_count && flush) {
-        AVStream *st;
-        pktl = s->internal->packet_buffer;
-        *out = pktl->pkt;
-        st   = s->streams[out->stream_index];
-
-        s->internal->packet_buffer = pktl->next;
-        if (!s->internal->packet_buffer)
-            s->internal->packet_buffer_end = NULL;
-
-        if (st->last_in_packet_buffer == pktl)
-            st->last_in_packet_buffer = NULL;
-        av_freep(&pktl);
-
+        ff_interleave_queue_get(s, out);
         return 1;
     } else {
         av_init_packet(out);
@@ -1139,25 +1284,23 @@ int ff_interleave_packet_per_dts(AVFormatContext *s, AVPacket *out,
 int ff_interleaved_peek(AVFormatContext *s, int stream,
                         AVPacket *pkt, int add_offset)
 {
-    AVPacketList *pktl = s->internal->packet_buffer;
-    while (pktl) {
-        if (pktl->pkt.stream_index == stream) {
-            *pkt = pktl->pkt;
-            if (add_offset) {
-                AVStream *st = s->streams[pkt->stream_index];
-                int64_t offset = st->mux_ts_offset;
-
-                if (s->output_ts_offset)
-                    offset += av_rescale_q(s->output_ts_offset, AV_TIME_BASE_Q, st->time_base);
-
-                if (pkt->dts != AV_NOPTS_VALUE)
-                    pkt->dts += offset;
-                if (pkt->pts != AV_NOPTS_VALUE)
-                    pkt->pts += offset;
-            }
-            return 0;
+    AVPacketList *pktl = s->streams[stream]->internal->first_in_packet_buffer;
+
+    if (pktl) {
+        *pkt = pktl->pkt;
+        if (add_offset) {
+            AVStream *st = s->streams[pkt->stream_index];
+            int64_t offset = st->mux_ts_offset;
+
+            if (s->output_ts_offset)
+                offset += av_rescale_q(s->output_ts_offset, AV_TIME_BASE_Q, st->time_base);
+
+            if (pkt->dts != AV_NOPTS_VALUE)
+                pkt->dts += offset;
+            if (pkt->pts != AV_NOPTS_VALUE)
+                pkt->pts += offset;
         }
-        pktl = pktl->next;
+        return 0;
     }
     return AVERROR(ENOENT);
 }
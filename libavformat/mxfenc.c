@@ -93,6 +93,7 @@ typedef struct MXFStreamContext {
     AVRational aspect_ratio; ///< display aspect ratio
     int closed_gop;          ///< gop is closed, used in mpeg-2 frame parsing
     int video_bit_rate;
+    AVPacketList *last_flush_packet; ///< last packet of the stream in MXFContext.flush_buffer
 } MXFStreamContext;
 
 typedef struct MXFContainerEssenceEntry {
@@ -389,6 +390,8 @@ typedef struct MXFContext {
     AVRational audio_edit_rate;
     int store_user_comments;
     int track_instance_count; // used to generate MXFTrack uuids
+    AVPacketList *flush_buffer;     ///< packets in interleaving order, when flushing
+    AVPacketList *flush_buffer_end;
 } MXFContext;
 
 static const uint8_t uuid_base[]            = { 0xAD,0xAB,0x44,0x24,0x2f,0x25,0x4d,0xc7,0x92,0xff,0x29,0xbd };
@@ -652,8 +655,10 @@ static void mxf_write_metadata_key(AVIOContext *pb, unsigned int value)
 
 static void mxf_free(AVFormatContext *s)
 {
+    MXFContext *mxf = s->priv_data;
     int i;
 
+    ff_packet_list_free(&mxf->flush_buffer, &mxf->flush_buffer_end);
     for (i = 0; i < s->nb_streams; i++) {
         AVStream *st = s->streams[i];
         av_freep(&st->priv_data);
@@ -2899,15 +2904,87 @@ end:
     return err < 0 ? err : 0;
 }
 
+static int mxf_compare_timestamps(AVFormatContext *s, AVPacket *next, AVPacket *pkt)
+{
+    MXFStreamContext *sc  = s->streams[pkt ->stream_index]->priv_data;
+    MXFStreamContext *sc2 = s->streams[next->stream_index]->priv_data;
+
+    return next->dts > pkt->dts ||
+        (next->dts == pkt->dts && sc->order < sc2->order);
+}
+
+/**
+ * Insert a packet in the flush buffer, searching its position from the last
+ * packet of its stream, and take ownership of it.
+ */
+static int mxf_flush_buffer_add(AVFormatContext *s, AVPacket *pkt)
+{
+    MXFContext *mxf = s->priv_data;
+    MXFStreamContext *sc = s->streams[pkt->stream_index]->priv_data;
+    AVPacketList **next_point, *this_pktl;
+
+    this_pktl = av_mallocz(sizeof(*this_pktl));
+    if (!this_pktl)
+        return AVERROR(ENOMEM);
+    this_pktl->pkt = *pkt;
+
+    next_point = sc->last_flush_packet ? &sc->last_flush_packet->next : &mxf->flush_buffer;
+    if (*next_point) {
+        if (mxf_compare_timestamps(s, &mxf->flush_buffer_end->pkt, pkt)) {
+            while (*next_point && !mxf_compare_timestamps(s, &(*next_point)->pkt, pkt))
+                next_point = &(*next_point)->next;
+        } else {
+            next_point = &mxf->flush_buffer_end->next;
+        }
+    }
+    if (!*next_point)
+        mxf->flush_buffer_end = this_pktl;
+    this_pktl->next = *next_point;
+    sc->last_flush_packet = *next_point = this_pktl;
+
+    return 0;
+}
+
 static int mxf_interleave_get_packet(AVFormatContext *s, AVPacket *out, AVPacket *pkt, int flush)
 {
-    int i, stream_count = 0;
+    MXFContext *mxf = s->priv_data;
+    int i, ret, stream_count = s->internal->nb_queued_streams;
+
+    /* When flushing, the last edit unit is searched in the list of all
+     * queued packets, so they are moved to the flush buffer. Once it is
+     * used, all packets go through it. */
+    if (mxf->flush_buffer ||
+        (flush && stream_count && s->nb_streams != stream_count)) {
+        AVPacket queued;
+
+        while (!ff_interleave_queue_get(s, &queued)) {
+            if ((ret = mxf_flush_buffer_add(s, &queued)) < 0) {
+                av_packet_unref(&queued);
+                return ret;
+            }
+        }
+    }
 
-    for (i = 0; i < s->nb_streams; i++)
-        stream_count += !!s->streams[i]->last_in_packet_buffer;
+    if (!mxf->flush_buffer) {
+        if (stream_count && s->nb_streams == stream_count) {
+            ff_interleave_queue_get(s, out);
+            av_log(s, AV_LOG_TRACE, "out st:%d dts:%"PRId64"\n", (*out).stream_index, (*out).dts);
+            return 1;
+        }
+        av_init_packet(out);
+        return 0;
+    }
+
+    stream_count = 0;
+    for (i = 0; i < s->nb_streams; i++) {
+        MXFStreamContext *sc = s->streams[i]->priv_data;
+        stream_count += !!sc->last_flush_packet;
+    }
 
     if (stream_count && (s->nb_streams == stream_count || flush)) {
-        AVPacketList *pktl = s->internal->packet_buffer;
+        AVPacketList *pktl = mxf->flush_buffer;
+        MXFStreamContext *sc;
+
         if (s->nb_streams != stream_count) {
             AVPacketList *last = NULL;
             // find last packet in edit unit
@@ -2922,29 +2999,31 @@ static int mxf_interleave_get_packet(AVFormatContext *s, AVPacket *out, AVPacket
             while (pktl) {
                 AVPacketList *next = pktl->next;
 
-                if(s->streams[pktl->pkt.stream_index]->last_in_packet_buffer == pktl)
-                    s->streams[pktl->pkt.stream_index]->last_in_packet_buffer= NULL;
+                sc = s->streams[pktl->pkt.stream_index]->priv_data;
+                if (sc->last_flush_packet == pktl)
+                    sc->last_flush_packet = NULL;
                 av_packet_unref(&pktl->pkt);
                 av_freep(&pktl);
                 pktl = next;
             }
+            mxf->flush_buffer_end = last;
             if (last)
                 last->next = NULL;
             else {
-                s->internal->packet_buffer = NULL;
-                s->internal->packet_buffer_end= NULL;
+                mxf->flush_buffer = NULL;
                 goto out;
             }
-            pktl = s->internal->packet_buffer;
+            pktl = mxf->flush_buffer;
         }
 
         *out = pktl->pkt;
         av_log(s, AV_LOG_TRACE, "out st:%d dts:%"PRId64"\n", (*out).stream_index, (*out).dts);
-        s->internal->packet_buffer = pktl->next;
-        if(s->streams[pktl->pkt.stream_index]->last_in_packet_buffer == pktl)
-            s->streams[pktl->pkt.stream_index]->last_in_packet_buffer= NULL;
-        if(!s->internal->packet_buffer)
-            s->internal->packet_buffer_end= NULL;
+        mxf->flush_buffer = pktl->next;
+        sc = s->streams[pktl->pkt.stream_index]->priv_data;
+        if (sc->last_flush_packet == pktl)
+            sc->last_flush_packet = NULL;
+        if (!mxf->flush_buffer)
+            mxf->flush_buffer_end = NULL;
         av_freep(&pktl);
         return 1;
     } else {
@@ -2954,15 +3033,6 @@ static int mxf_interleave_get_packet(AVFormatContext *s, AVPacket *out, AVPacket
     }
 }
 
-static int mxf_compare_timestamps(AVFormatContext *s, AVPacket *next, AVPacket *pkt)
-{
-    MXFStreamContext *sc  = s->streams[pkt ->stream_index]->priv_data;
-    MXFStreamContext *sc2 = s->streams[next->stream_index]->priv_data;
-
-    return next->dts > pkt->dts ||
-        (next->dts == pkt->dts && sc->order < sc2->order);
-}
-
 static int mxf_interleave(AVFormatContext *s, AVPacket *out, AVPacket *pkt, int flush)
 {
     return ff_audio_rechunk_interleave(s, out, pkt, flush,
@@ -0,0 +1,363 @@
+/*
+ * Persistent cache of the results of probing and stream analysis
+ *
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/*
+ * An entry is a text file of key=value lines, named after the MD5 of the
+ * URL. Besides the file identity, it holds the name of the input format,
+ * the timings of the file and, for each stream, the codec parameters,
+ * frame rates and timings found by avformat_find_stream_info(), as well
+ * as the fields of the decoder context that find_stream_info() exports
+ * through the deprecated AVStream.codec. String
+ * values are backslash escaped, as av_dict_parse_string() unescapes them.
+ */
+
+#include <stdlib.h>
+#include <sys/stat.h>
+
+#include "libavutil/avstring.h"
+#include "libavutil/dict.h"
+#include "libavutil/md5.h"
+#include "avformat.h"
+#include "avio_internal.h"
+#include "internal.h"
+#include "os_support.h"
+#include "probecache.h"
+
+#define PROBE_CACHE_VERSION  2
+#define PROBE_CACHE_MAX_SIZE (16 << 20)
+
+struct FFProbeCache {
+    char *path;          ///< path of the entry
+    int64_t size;        ///< size of the input file
+    int64_t mtime;       ///< modification time of the input file
+    AVDictionary *entry; ///< valid entry read from the cache, NULL if none
+};
+
+#define PAR_INT(x)   { #x, offsetof(AVCodecParameters, x), 0 }
+#define PAR_INT64(x) { #x, offsetof(AVCodecParameters, x), 1 }
+static const struct {
+    const char *name;
+    size_t offset;
+    int is_int64;
+} par_fields[] = {
+    PAR_INT(codec_type),
+    PAR_INT(codec_id),
+    PAR_INT(codec_tag),
+    PAR_INT(format),
+    PAR_INT64(bit_rate),
+    PAR_INT(bits_per_coded_sample),
+    PAR_INT(bits_per_raw_sample),
+    PAR_INT(profile),
+    PAR_INT(level),
+    PAR_INT(width),
+    PAR_INT(height),
+    PAR_INT(sample_aspect_ratio.num),
+    PAR_INT(sample_aspect_ratio.den),
+    PAR_INT(field_order),
+    PAR_INT(color_range),
+    PAR_INT(color_primaries),
+    PAR_INT(color_trc),
+    PAR_INT(color_space),
+    PAR_INT(chroma_location),
+    PAR_INT(video_delay),
+    PAR_INT64(channel_layout),
+    PAR_INT(channels),
+    PAR_INT(sample_rate),
+    PAR_INT(block_align),
+    PAR_INT(frame_size),
+    PAR_INT(initial_padding),
+    PAR_INT(trailing_padding),
+    PAR_INT(seek_preroll),
+};
+
+static const char *get_value(AVDictionary *entry, int index, const char *key)
+{
+    char name[64];
+    AVDictionaryEntry *e;
+
+    if (index >= 0) {
+        snprintf(name, sizeof(name), "%d.%s", index, key);
+        key = name;
+    }
+    e = av_dict_get(entry, key, NULL, AV_DICT_MATCH_CASE);
+    return e ? e->value : NULL;
+}
+
+static int64_t get_int(AVDictionary *entry, int index, const char *key, int64_t def)
+{
+    const char *value = get_value(entry, index, key);
+    return value ? strtoll(value, NULL, 10) : def;
+}
+
+static AVRational get_rational(AVDictionary *entry, int index, const char *key)
+{
+    const char *value = get_value(entry, index, key);
+    AVRational q = { 0, 1 };
+
+    if (value)
+        sscanf(value, "%d/%d", &q.num, &q.den);
+    return q;
+}
+
+/* Write a string value, escaped for av_dict_parse_string(). */
+static void write_string(AVIOContext *pb, const char *key, const char *value)
+{
+    char *escaped = NULL;
+
+    if (av_escape(&escaped, value, "=\n", AV_ESCAPE_MODE_BACKSLASH,
+                  AV_ESCAPE_FLAG_WHITESPACE) < 0) {
+        pb->error = AVERROR(ENOMEM);
+        return;
+    }
+    avio_printf(pb, "%s=%s\n", key, escaped);
+    av_free(escaped);
+}
+
+static AVDictionary *read_entry(AVFormatContext *s, FFProbeCache *pc)
+{
+    AVIOContext *pb = NULL;
+    AVDictionary *entry = NULL;
+    const char *url;
+    char *buf = NULL;
+    int64_t size;
+
+    if (avio_open2(&pb, pc->path, AVIO_FLAG_READ, &s->interrupt_callback, NULL) < 0)
+        return NULL;
+    size = avio_size(pb);
+    if (size > 0 && size < PROBE_CACHE_MAX_SIZE && (buf = av_malloc(size + 1))) {
+        if (avio_read(pb, buf, size) == size) {
+            buf[size] = 0;
+            av_dict_parse_string(&entry, buf, "=", "\n", 0);
+        }
+        av_free(buf);
+    }
+    avio_closep(&pb);
+
+    url = get_value(entry, -1, "url");
+    if (get_int(entry, -1, "version", 0) != PROBE_CACHE_VERSION ||
+        !url || strcmp(url, s->url) ||
+        get_int(entry, -1, "size",  -1) != pc->size ||
+        get_int(entry, -1, "mtime", -1) != pc->mtime)
+        av_dict_free(&entry);
+    return entry;
+}
+
+int ff_probe_cache_open(AVFormatContext *s, const char *filename)
+{
+    FFProbeCache *pc;
+    const char *proto = avio_find_protocol_name(filename);
+    const char *path  = filename;
+    uint8_t md5[16];
+    char hex[33];
+    struct stat st;
+
+    if (!s->probe_cache || !proto || strcmp(proto, "file"))
+        return 0;
+    av_strstart(filename, "file:", &path);
+    if (stat(path, &st) < 0 || !S_ISREG(st.st_mode))
+        return 0;
+
+    pc = av_mallocz(sizeof(*pc));
+    if (!pc)
+        return AVERROR(ENOMEM);
+    s->internal->probe_cache = pc;
+    pc->size  = st.st_size;
+    pc->mtime = st.st_mtime;
+
+    av_md5_sum(md5, filename, strlen(filename));
+    ff_data_to_hex(hex, md5, sizeof(md5), 1);
+    hex[32] = 0;
+    pc->path = av_asprintf("%s/%s.txt", s->probe_cache, hex);
+    if (!pc->path)
+        return AVERROR(ENOMEM);
+
+    pc->entry = read_entry(s, pc);
+    if (!pc->entry)
+        return 0;
+    av_log(s, AV_LOG_VERBOSE, "Using the probe cache entry %s\n", pc->path);
+
+    if (s->iformat)
+        return 0;
+    s->iformat = av_find_input_format(get_value(pc->entry, -1, "format"));
+    return s->iformat ? get_int(pc->entry, -1, "probe_score", AVPROBE_SCORE_MAX) : 0;
+}
+
+int ff_probe_cache_apply(AVFormatContext *s)
+{
+    FFProbeCache *pc = s->internal->probe_cache;
+    const char *format;
+    int i, j;
+
+    if (!pc || !pc->entry)
+        return 0;
+    /* streams may be added while reading packets if there is no header */
+    if (s->ctx_flags & AVFMTCTX_NOHEADER) {
+        av_dict_free(&pc->entry);
+        return 0;
+    }
+
+    /* the entry must describe the streams the demuxer created; if it does
+     * not, drop it so that ff_probe_cache_store() replaces it */
+    format = get_value(pc->entry, -1, "format");
+    if (!format || strcmp(format, s->iformat->name) ||
+        get_int(pc->entry, -1, "nb_streams", -1) != s->nb_streams)
+        goto mismatch;
+    for (i = 0; i < s->nb_streams; i++) {
+        AVStream *st = s->streams[i];
+        if (get_int(pc->entry, i, "id", -1) != st->id ||
+            av_cmp_q(get_rational(pc->entry, i, "time_base"), st->time_base))
+            goto mismatch;
+    }
+
+    for (i = 0; i < s->nb_streams; i++) {
+        AVStream *st = s->streams[i];
+        AVCodecParameters *par = st->codecpar;
+        AVCodecContext *avctx = st->internal->avctx;
+        const char *extradata = get_value(pc->entry, i, "extradata");
+        int ret;
+
+        for (j = 0; j < FF_ARRAY_ELEMS(par_fields); j++) {
+            int64_t v = get_int(pc->entry, i, par_fields[j].name, 0);
+            if (par_fields[j].is_int64)
+                *(int64_t *)((uint8_t *)par + par_fields[j].offset) = v;
+            else
+                *(int *)((uint8_t *)par + par_fields[j].offset) = v;
+        }
+
+        av_freep(&par->extradata);
+        par->extradata_size = 0;
+        if (extradata && *extradata) {
+            int size = strlen(extradata) / 2;
+            par->extradata = av_mallocz(size + AV_INPUT_BUFFER_PADDING_SIZE);
+            if (!par->extradata)
+                return AVERROR(ENOMEM);
+            par->extradata_size = ff_hex_to_data(par->extradata, extradata);
+        }
+
+        st->avg_frame_rate = get_rational(pc->entry, i, "avg_frame_rate");
+        st->r_frame_rate   = get_rational(pc->entry, i, "r_frame_rate");
+        st->start_time     = get_int(pc->entry, i, "start_time", AV_NOPTS_VALUE);
+        st->duration       = get_int(pc->entry, i, "duration",   AV_NOPTS_VALUE);
+        st->codec_info_nb_frames = get_int(pc->entry, i, "codec_info_nb_frames", 0);
+
+        /* the decoder context, which find_stream_info() copies to st->codec */
+        ret = avcodec_parameters_to_context(avctx, par);
+        if (ret < 0)
+            return ret;
+        avctx->coded_width     = get_int(pc->entry, i, "coded_width",     0);
+        avctx->coded_height    = get_int(pc->entry, i, "coded_height",    0);
+        avctx->time_base       = get_rational(pc->entry, i, "codec_time_base");
+        avctx->ticks_per_frame = get_int(pc->entry, i, "ticks_per_frame", 1);
+        avctx->properties      = get_int(pc->entry, i, "properties",      0);
+        st->internal->need_context_update = 1;
+    }
+    s->start_time = get_int(pc->entry, -1, "start_time", AV_NOPTS_VALUE);
+    s->duration   = get_int(pc->entry, -1, "duration",   AV_NOPTS_VALUE);
+    s->bit_rate   = get_int(pc->entry, -1, "bit_rate",   0);
+    return 1;
+
+mismatch:
+    av_log(s, AV_LOG_VERBOSE, "The probe cache entry %s does not match the streams\n",
+           pc->path);
+    av_dict_free(&pc->entry);
+    return 0;
+}
+
+void ff_probe_cache_store(AVFormatContext *s)
+{
+    FFProbeCache *pc = s->internal->probe_cache;
+    AVIOContext *pb = NULL;
+    char *tmp;
+    int i, j;
+
+    if (!pc || pc->entry || !pc->path)
+        return;
+
+    tmp = av_asprintf("%s.tmp", pc->path);
+    if (!tmp)
+        return;
+    if (avio_open2(&pb, tmp, AVIO_FLAG_WRITE, &s->interrupt_callback, NULL) < 0) {
+        av_log(s, AV_LOG_WARNING, "Could not write the probe cache entry %s\n", tmp);
+        av_free(tmp);
+        return;
+    }
+
+    avio_printf(pb, "version=%d\n", PROBE_CACHE_VERSION);
+    write_string(pb, "url", s->url);
+    avio_printf(pb, "size=%"PRId64"\nmtime=%"PRId64"\n", pc->size, pc->mtime);
+    write_string(pb, "format", s->iformat->name);
+    avio_printf(pb, "probe_score=%d\n", s->probe_score);
+    avio_printf(pb, "start_time=%"PRId64"\nduration=%"PRId64"\n", s->start_time, s->duration);
+    avio_printf(pb, "bit_rate=%"PRId64"\n", s->bit_rate);
+    avio_printf(pb, "nb_streams=%d\n", s->nb_streams);
+    for (i = 0; i < s->nb_streams; i++) {
+        AVStream *st = s->streams[i];
+        AVCodecParameters *par = st->codecpar;
+        AVCodecContext *avctx = st->internal->avctx;
+
+        avio_printf(pb, "%d.id=%d\n", i, st->id);
+        avio_printf(pb, "%d.time_base=%d/%d\n", i, st->time_base.num, st->time_base.den);
+        for (j = 0; j < FF_ARRAY_ELEMS(par_fields); j++) {
+            const uint8_t *p = (const uint8_t *)par + par_fields[j].offset;
+            avio_printf(pb, "%d.%s=%"PRId64"\n", i, par_fields[j].name,
+                        par_fields[j].is_int64 ? *(const int64_t *)p : *(const int *)p);
+        }
+        avio_printf(pb, "%d.avg_frame_rate=%d/%d\n", i, st->avg_frame_rate.num, st->avg_frame_rate.den);
+        avio_printf(pb, "%d.r_frame_rate=%d/%d\n", i, st->r_frame_rate.num, st->r_frame_rate.den);
+        avio_printf(pb, "%d.start_time=%"PRId64"\n", i, st->start_time);
+        avio_printf(pb, "%d.duration=%"PRId64"\n", i, st->duration);
+        avio_printf(pb, "%d.codec_info_nb_frames=%d\n", i, st->codec_info_nb_frames);
+        avio_printf(pb, "%d.coded_width=%d\n%d.coded_height=%d\n", i, avctx->coded_width,
+                    i, avctx->coded_height);
+        avio_printf(pb, "%d.codec_time_base=%d/%d\n", i, avctx->time_base.num, avctx->time_base.den);
+        avio_printf(pb, "%d.ticks_per_frame=%d\n", i, avctx->ticks_per_frame);
+        avio_printf(pb, "%d.properties=%u\n", i, avctx->properties);
+        if (par->extradata_size > 0) {
+            char hex[129];
+            avio_printf(pb, "%d.extradata=", i);
+            for (j = 0; j < par->extradata_size; j += 64) {
+                int len = FFMIN(64, par->extradata_size - j);
+                ff_data_to_hex(hex, par->extradata + j, len, 1);
+                avio_write(pb, hex, 2 * len);
+            }
+            avio_w8(pb, '\n');
+        }
+    }
+    avio_flush(pb);
+    if (pb->error >= 0) {
+        avio_closep(&pb);
+        ff_rename(tmp, pc->path, s);
+    } else {
+        avio_closep(&pb);
+        avpriv_io_delete(tmp);
+    }
+    av_free(tmp);
+}
+
+void ff_probe_cache_free(FFProbeCache **ppc)
+{
+    FFProbeCache *pc = *ppc;
+
+    if (!pc)
+        return;
+    av_dict_free(&pc->entry);
+    av_freep(&pc->path);
+    av_freep(ppc);
+}
@@ -0,0 +1,65 @@
+/*
+ * Persistent cache of the results of probing and stream analysis
+ *
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#ifndef AVFORMAT_PROBECACHE_H
+#define AVFORMAT_PROBECACHE_H
+
+#include "avformat.h"
+
+/**
+ * Cache entry of one local file, stored in the directory given by
+ * AVFormatContext.probe_cache and keyed by the URL, size and modification
+ * time of the file.
+ */
+typedef struct FFProbeCache FFProbeCache;
+
+/**
+ * Look up the cache entry of filename. If it is valid and s->iformat is
+ * not set yet, s->iformat is set to the format of the entry, so that the
+ * input is not probed.
+ *
+ * Nothing is done if s->probe_cache is not set or filename is not a local
+ * file.
+ *
+ * @return the probe score of the format if s->iformat was set from the
+ *         entry, 0 if not, a negative AVERROR code on error
+ */
+int ff_probe_cache_open(AVFormatContext *s, const char *filename);
+
+/**
+ * Set the codec parameters, frame rates, timings and decoder context of
+ * the streams from the cache entry, if it matches the streams created by
+ * the demuxer. An entry that does not match is dropped, so that
+ * ff_probe_cache_store() rewrites it.
+ *
+ * @return 1 if the parameters were set, 0 if there is no matching entry,
+ *         a negative AVERROR code on error
+ */
+int ff_probe_cache_apply(AVFormatContext *s);
+
+/**
+ * Write the cache entry of s after avformat_find_stream_info() analyzed it,
+ * unless the parameters were set from the entry.
+ */
+void ff_probe_cache_store(AVFormatContext *s);
+
+void ff_probe_cache_free(FFProbeCache **pc);
+
+#endif /* AVFORMAT_PROBECACHE_H */
@@ -26,6 +26,9 @@
 
 #define _DEFAULT_SOURCE
 #define _BSD_SOURCE     /* Needed for using struct ip_mreq with recent glibc */
+#define _GNU_SOURCE     /* Needed for recvmmsg() and sendmmsg() */
+
+#include <stdatomic.h>
 
 #include "avformat.h"
 #include "avio_internal.h"
@@ -72,6 +75,12 @@
 #define UDP_TX_BUF_SIZE 32768
 #define UDP_MAX_PKT_SIZE 65536
 #define UDP_HEADER_SIZE 8
+#if HAVE_RECVMMSG
+#define UDP_RX_BATCH 32 ///< maximum number of datagrams received by one system call
+#else
+#define UDP_RX_BATCH 1
+#endif
+#define UDP_TX_BATCH 32 ///< maximum number of datagrams sent by one system call
 
 typedef struct UDPContext {
     const AVClass *class;
@@ -85,6 +94,7 @@ typedef struct UDPContext {
     int local_port;
     int reuse_socket;
     int overrun_nonfatal;
+    int merge_datagrams;
     struct sockaddr_storage dest_addr;
     int dest_addr_len;
     int is_connected;
@@ -101,6 +111,21 @@ typedef struct UDPContext {
     pthread_mutex_t mutex;
     pthread_cond_t cond;
     int thread_started;
+
+    /* Lock-free ring of received datagrams, each stored as a 32-bit length
+     * followed by the data. circular_buffer_task_rx() is the only writer of
+     * rx_head and udp_read() the only writer of rx_tail; both are offsets
+     * into the ring. The ring is one byte larger than fifo_size, so that it
+     * is empty when rx_head == rx_tail and never completely full. The mutex
+     * is only used to sleep while the ring is empty. */
+    uint8_t *rx_ring;
+    unsigned rx_ring_size;
+    atomic_uint rx_head;
+    atomic_uint rx_tail;
+    atomic_int rx_waiting;  ///< udp_read() is waiting for the condition
+    atomic_int rx_error;
+    uint8_t *rx_batch;      ///< UDP_RX_BATCH receive buffers of rx_slot_size
+    int rx_slot_size;       ///< pkt_size, the largest datagram received whole
 #endif
     uint8_t tmp[UDP_MAX_PKT_SIZE+4];
     int remaining_in_dg;
@@ -128,8 +153,9 @@ static const AVOption options[] = {
     { "broadcast", "explicitly allow or disallow broadcast destination",   OFFSET(is_broadcast),   AV_OPT_TYPE_BOOL,   { .i64 = 0  },     0, 1,       E },
     { "ttl",            "Time to live (multicast only)",                   OFFSET(ttl),            AV_OPT_TYPE_INT,    { .i64 = 16 },     0, INT_MAX, E },
     { "connect",        "set if connect() should be called on socket",     OFFSET(is_connected),   AV_OPT_TYPE_BOOL,   { .i64 =  0 },     0, 1,       .flags = D|E },
-    { "fifo_size",      "set the UDP receiving circular buffer size, expressed as a number of packets with size of 188 bytes", OFFSET(circular_buffer_size), AV_OPT_TYPE_INT, {.i64 = 7*4096}, 0, INT_MAX, D },
+    { "fifo_size",      "set the UDP circular buffer size, expressed as a number of packets with size of 188 bytes", OFFSET(circular_buffer_size), AV_OPT_TYPE_INT, {.i64 = -1}, -1, INT_MAX, D|E },
     { "overrun_nonfatal", "survive in case of UDP receiving circular buffer overrun", OFFSET(overrun_nonfatal), AV_OPT_TYPE_BOOL, {.i64 = 0}, 0, 1,    D },
+    { "merge_datagrams", "return several datagrams from the circular buffer per read", OFFSET(merge_datagrams), AV_OPT_TYPE_BOOL, {.i64 = 0}, 0, 1,    D },
     { "timeout",        "set raise error timeout (only in read mode)",     OFFSET(timeout),        AV_OPT_TYPE_INT,    { .i64 = 0 },      0, INT_MAX, D },
     { "sources",        "Source list",                                     OFFSET(sources),        AV_OPT_TYPE_STRING, { .str = NULL },               .flags = D|E },
     { "block",          "Block list",                                      OFFSET(block),          AV_OPT_TYPE_STRING, { .str = NULL },               .flags = D|E },
@@ -492,63 +518,177 @@ static int udp_get_file_handle(URLContext *h)
 }
 
 #if HAVE_PTHREAD_CANCEL
+static unsigned rx_ring_advance(UDPContext *s, unsigned pos, int len)
+{
+    pos += len;
+    return pos >= s->rx_ring_size ? pos - s->rx_ring_size : pos;
+}
+
+static unsigned rx_ring_space(UDPContext *s, unsigned head, unsigned tail)
+{
+    unsigned used = head >= tail ? head - tail : head + s->rx_ring_size - tail;
+    return s->rx_ring_size - 1 - used;
+}
+
+static void rx_ring_write(UDPContext *s, unsigned pos, const uint8_t *src, int len)
+{
+    unsigned first = FFMIN(len, s->rx_ring_size - pos);
+
+    memcpy(s->rx_ring + pos, src, first);
+    memcpy(s->rx_ring, src + first, len - first);
+}
+
+static void rx_ring_read(UDPContext *s, unsigned pos, uint8_t *dst, int len)
+{
+    unsigned first = FFMIN(len, s->rx_ring_size - pos);
+
+    memcpy(dst, s->rx_ring + pos, first);
+    memcpy(dst + first, s->rx_ring, len - first);
+}
+
+/**
+ * Receive up to UDP_RX_BATCH datagrams, blocking until at least one is
+ * available. The lengths are stored in lens.
+ */
+static int rx_receive_batch(UDPContext *s, int *lens)
+{
+#if HAVE_RECVMMSG
+    struct mmsghdr msgs[UDP_RX_BATCH];
+    struct iovec iov[UDP_RX_BATCH];
+    int i, ret;
+
+    memset(msgs, 0, sizeof(msgs));
+    for (i = 0; i < UDP_RX_BATCH; i++) {
+        iov[i].iov_base = s->rx_batch + i * s->rx_slot_size;
+        iov[i].iov_len  = s->rx_slot_size;
+        msgs[i].msg_hdr.msg_iov    = &iov[i];
+        msgs[i].msg_hdr.msg_iovlen = 1;
+    }
+    ret = recvmmsg(s->udp_fd, msgs, UDP_RX_BATCH, MSG_WAITFORONE, NULL);
+    for (i = 0; i < ret; i++) {
+        lens[i] = msgs[i].msg_len;
+        if (msgs[i].msg_hdr.msg_flags & MSG_TRUNC)
+            av_log(s, AV_LOG_WARNING, "Part of datagram lost, "
+                   "increase pkt_size URL option above %d\n", s->rx_slot_size);
+    }
+    return ret;
+#else
+    int len = recv(s->udp_fd, s->rx_batch, s->rx_slot_size, 0);
+    if (len < 0)
+        return len;
+    lens[0] = len;
+    return 1;
+#endif
+}
+
 static void *circular_buffer_task_rx( void *_URLContext)
 {
     URLContext *h = _URLContext;
     UDPContext *s = h->priv_data;
     int old_cancelstate;
+    int lens[UDP_RX_BATCH];
 
     pthread_setcancelstate(PTHREAD_CANCEL_DISABLE, &old_cancelstate);
-    pthread_mutex_lock(&s->mutex);
     if (ff_socket_nonblock(s->udp_fd, 0) < 0) {
         av_log(h, AV_LOG_ERROR, "Failed to set blocking mode");
-        s->circular_buffer_error = AVERROR(EIO);
+        atomic_store(&s->rx_error, AVERROR(EIO));
         goto end;
     }
     while(1) {
-        int len;
+        unsigned head = atomic_load_explicit(&s->rx_head, memory_order_relaxed);
+        int i, nb;
 
-        pthread_mutex_unlock(&s->mutex);
         /* Blocking operations are always cancellation points;
            see "General Information" / "Thread Cancelation Overview"
            in Single Unix. */
         pthread_setcancelstate(PTHREAD_CANCEL_ENABLE, &old_cancelstate);
-        len = recv(s->udp_fd, s->tmp+4, sizeof(s->tmp)-4, 0);
+        nb = rx_receive_batch(s, lens);
         pthread_setcancelstate(PTHREAD_CANCEL_DISABLE, &old_cancelstate);
-        pthread_mutex_lock(&s->mutex);
-        if (len < 0) {
+        if (nb < 0) {
             if (ff_neterrno() != AVERROR(EAGAIN) && ff_neterrno() != AVERROR(EINTR)) {
-                s->circular_buffer_error = ff_neterrno();
+                atomic_store(&s->rx_error, ff_neterrno());
                 goto end;
             }
             continue;
         }
-        AV_WL32(s->tmp, len);
-
-        if(av_fifo_space(s->fifo) < len + 4) {
-            /* No Space left */
-            if (s->overrun_nonfatal) {
-                av_log(h, AV_LOG_WARNING, "Circular buffer overrun. "
-                        "Surviving due to overrun_nonfatal option\n");
-                continue;
-            } else {
-                av_log(h, AV_LOG_ERROR, "Circular buffer overrun. "
-                        "To avoid, increase fifo_size URL option. "
-                        "To survive in such case, use overrun_nonfatal option\n");
-                s->circular_buffer_error = AVERROR(EIO);
-                goto end;
+
+        for (i = 0; i < nb; i++) {
+            unsigned tail = atomic_load_explicit(&s->rx_tail, memory_order_acquire);
+            uint8_t len[4];
+
+            if (rx_ring_space(s, head, tail) < lens[i] + 4) {
+                /* No Space left */
+                if (s->overrun_nonfatal) {
+                    av_log(h, AV_LOG_WARNING, "Circular buffer overrun. "
+                            "Surviving due to overrun_nonfatal option\n");
+                    continue;
+                } else {
+                    av_log(h, AV_LOG_ERROR, "Circular buffer overrun. "
+                            "To avoid, increase fifo_size URL option. "
+                            "To survive in such case, use overrun_nonfatal option\n");
+                    atomic_store(&s->rx_error, AVERROR(EIO));
+                    goto end;
+                }
             }
+            AV_WL32(len, lens[i]);
+            rx_ring_write(s, head, len, 4);
+            head = rx_ring_advance(s, head, 4);
+            rx_ring_write(s, head, s->rx_batch + i * s->rx_slot_size, lens[i]);
+            head = rx_ring_advance(s, head, lens[i]);
+        }
+        atomic_store(&s->rx_head, head);
+
+        if (atomic_load(&s->rx_waiting)) {
+            pthread_mutex_lock(&s->mutex);
+            pthread_cond_signal(&s->cond);
+            pthread_mutex_unlock(&s->mutex);
         }
-        av_fifo_generic_write(s->fifo, s->tmp, len+4, NULL);
-        pthread_cond_signal(&s->cond);
     }
 
 end:
+    pthread_mutex_lock(&s->mutex);
     pthread_cond_signal(&s->cond);
     pthread_mutex_unlock(&s->mutex);
     return NULL;
 }
 
+/**
+ * Send the nb datagrams stored back to back in buf, with the lengths in lens.
+ * @return the number of datagrams sent, or a negative value on error
+ */
+static int tx_send_batch(UDPContext *s, const uint8_t *buf, const int *lens, int nb)
+{
+#if HAVE_SENDMMSG
+    struct mmsghdr msgs[UDP_TX_BATCH];
+    struct iovec iov[UDP_TX_BATCH];
+    int i;
+
+    memset(msgs, 0, nb * sizeof(*msgs));
+    for (i = 0; i < nb; i++) {
+        iov[i].iov_base = (void *)buf;
+        iov[i].iov_len  = lens[i];
+        buf += lens[i];
+        msgs[i].msg_hdr.msg_iov    = &iov[i];
+        msgs[i].msg_hdr.msg_iovlen = 1;
+        if (!s->is_connected) {
+            msgs[i].msg_hdr.msg_name    = &s->dest_addr;
+            msgs[i].msg_hdr.msg_namelen = s->dest_addr_len;
+        }
+    }
+    return sendmmsg(s->udp_fd, msgs, nb, 0);
+#else
+    int ret;
+
+    if (!s->is_connected) {
+        ret = sendto (s->udp_fd, buf, lens[0], 0,
+                    (struct sockaddr *) &s->dest_addr,
+                    s->dest_addr_len);
+    } else
+        ret = send(s->udp_fd, buf, lens[0], 0);
+    return ret < 0 ? ret : 1;
+#endif
+}
+
 static void *circular_buffer_task_tx( void *_URLContext)
 {
     URLContext *h = _URLContext;
@@ -558,7 +698,8 @@ static void *circular_buffer_task_tx( void *_URLContext)
     int64_t start_timestamp = av_gettime_relative();
     int64_t sent_bits = 0;
     int64_t burst_interval = s->bitrate ? (s->burst_bits * 1000000 / s->bitrate) : 0;
-    int64_t max_delay = s->bitrate ?  ((int64_t)h->max_packet_size * 8 * 1000000 / s->bitrate + 1) : 0;
+    /* a batch may be sent up to burst_interval ahead of its schedule */
+    int64_t max_delay = s->bitrate ?  ((int64_t)h->max_packet_size * 8 * 1000000 / s->bitrate + 1) + burst_interval : 0;
 
     pthread_setcancelstate(PTHREAD_CANCEL_DISABLE, &old_cancelstate);
     pthread_mutex_lock(&s->mutex);
@@ -570,10 +711,11 @@ static void *circular_buffer_task_tx( void *_URLContext)
     }
 
     for(;;) {
-        int len;
+        int len, size, nb, i;
+        int lens[UDP_TX_BATCH];
         const uint8_t *p;
         uint8_t tmp[4];
-        int64_t timestamp;
+        int64_t timestamp = 0;
 
         len=av_fifo_size(s->fifo);
 
@@ -593,11 +735,13 @@ static void *circular_buffer_task_tx( void *_URLContext)
         av_assert0(len <= sizeof(s->tmp));
 
         av_fifo_generic_read(s->fifo, s->tmp, len, NULL);
-
-        pthread_mutex_unlock(&s->mutex);
-        pthread_setcancelstate(PTHREAD_CANCEL_ENABLE, &old_cancelstate);
+        lens[0] = size = len;
+        nb = 1;
 
         if (s->bitrate) {
+            pthread_mutex_unlock(&s->mutex);
+            pthread_setcancelstate(PTHREAD_CANCEL_ENABLE, &old_cancelstate);
+
             timestamp = av_gettime_relative();
             if (timestamp < target_timestamp) {
                 int64_t delay = target_timestamp - timestamp;
@@ -607,6 +751,7 @@ static void *circular_buffer_task_tx( void *_URLContext)
                     sent_bits = 0;
                 }
                 av_usleep(delay);
+                timestamp += delay;
             } else {
                 if (timestamp - burst_interval > target_timestamp) {
                     start_timestamp = timestamp - burst_interval;
@@ -615,26 +760,48 @@ static void *circular_buffer_task_tx( void *_URLContext)
             }
             sent_bits += len * 8;
             target_timestamp = start_timestamp + sent_bits * 1000000 / s->bitrate;
+
+            pthread_setcancelstate(PTHREAD_CANCEL_DISABLE, &old_cancelstate);
+            pthread_mutex_lock(&s->mutex);
+        }
+
+        /* Send the packets that are already queued along with the first
+         * one, as long as they fit in s->tmp and, when pacing, they are
+         * due within the allowed burst. Without pacing, this is everything
+         * udp_write() queued while the previous batch was being sent. */
+        while (nb < UDP_TX_BATCH && av_fifo_size(s->fifo) >= 4) {
+            av_fifo_generic_peek(s->fifo, tmp, 4, NULL);
+            len = AV_RL32(tmp);
+            if (size + len > sizeof(s->tmp) ||
+                (s->bitrate && target_timestamp > timestamp + burst_interval))
+                break;
+            av_fifo_drain(s->fifo, 4);
+            av_fifo_generic_read(s->fifo, s->tmp + size, len, NULL);
+            lens[nb++] = len;
+            size += len;
+            if (s->bitrate) {
+                sent_bits += len * 8;
+                target_timestamp = start_timestamp + sent_bits * 1000000 / s->bitrate;
+            }
         }
+        /* wake up udp_write() if it is waiting for room in the fifo */
+        pthread_cond_signal(&s->cond);
+        pthread_mutex_unlock(&s->mutex);
+        pthread_setcancelstate(PTHREAD_CANCEL_ENABLE, &old_cancelstate);
 
         p = s->tmp;
-        while (len) {
-            int ret;
-            av_assert0(len > 0);
-            if (!s->is_connected) {
-                ret = sendto (s->udp_fd, p, len, 0,
-                            (struct sockaddr *) &s->dest_addr,
-                            s->dest_addr_len);
-            } else
-                ret = send(s->udp_fd, p, len, 0);
+        i = 0;
+        while (i < nb) {
+            int ret = tx_send_batch(s, p, lens + i, nb - i);
             if (ret >= 0) {
-                len -= ret;
-                p   += ret;
+                while (ret--)
+                    p += lens[i++];
             } else {
                 ret = ff_neterrno();
                 if (ret != AVERROR(EAGAIN) && ret != AVERROR(EINTR)) {
                     pthread_mutex_lock(&s->mutex);
                     s->circular_buffer_error = ret;
+                    pthread_cond_signal(&s->cond);
                     pthread_mutex_unlock(&s->mutex);
                     return NULL;
                 }
@@ -646,6 +813,7 @@ static void *circular_buffer_task_tx( void *_URLContext)
     }
 
 end:
+    pthread_cond_signal(&s->cond);
     pthread_mutex_unlock(&s->mutex);
     return NULL;
 }
@@ -731,6 +899,13 @@ static int udp_open(URLContext *h, const char *uri, int flags)
                        "'overrun_nonfatal' option was set but it is not supported "
                        "on this build (pthread support is required)\n");
         }
+        if (av_find_info_tag(buf, sizeof(buf), "merge_datagrams", p)) {
+            char *endptr = NULL;
+            s->merge_datagrams = strtol(buf, &endptr, 10);
+            /* assume if no digits were found it is a request to enable it */
+            if (buf == endptr)
+                s->merge_datagrams = 1;
+        }
         if (av_find_info_tag(buf, sizeof(buf), "ttl", p)) {
             s->ttl = strtol(buf, NULL, 10);
         }
@@ -788,6 +963,8 @@ static int udp_open(URLContext *h, const char *uri, int flags)
             s->is_broadcast = strtol(buf, NULL, 10);
     }
     /* handling needed to support options picking from both AVOption and URL */
+    if (s->circular_buffer_size < 0)
+        s->circular_buffer_size = !is_output || s->bitrate ? 7*4096 : 0;
     s->circular_buffer_size *= 188;
     if (flags & AVIO_FLAG_WRITE) {
         h->max_packet_size = s->pkt_size;
@@ -951,7 +1128,8 @@ static int udp_open(URLContext *h, const char *uri, int flags)
     /*
       Create thread in case of:
       1. Input and circular_buffer_size is set
-      2. Output and bitrate and circular_buffer_size is set
+      2. Output and circular_buffer_size is set, which is the default when
+         bitrate is set
     */
 
     if (is_output && s->bitrate && !s->circular_buffer_size) {
@@ -959,11 +1137,27 @@ static int udp_open(URLContext *h, const char *uri, int flags)
         av_log(h, AV_LOG_WARNING,"'bitrate' option was set but 'circular_buffer_size' is not, but required\n");
     }
 
-    if ((!is_output && s->circular_buffer_size) || (is_output && s->bitrate && s->circular_buffer_size)) {
+    if (s->circular_buffer_size) {
         int ret;
 
         /* start the task going */
-        s->fifo = av_fifo_alloc(s->circular_buffer_size);
+        if (is_output) {
+            s->fifo = av_fifo_alloc(s->circular_buffer_size);
+            if (!s->fifo)
+                goto fail;
+        } else {
+            s->rx_slot_size = s->pkt_size > 0 ? FFMIN(s->pkt_size, UDP_MAX_PKT_SIZE)
+                                              : UDP_MAX_PKT_SIZE;
+            s->rx_ring_size = s->circular_buffer_size + 1;
+            s->rx_ring  = av_malloc(s->rx_ring_size);
+            s->rx_batch = av_malloc(UDP_RX_BATCH * s->rx_slot_size);
+            if (!s->rx_ring || !s->rx_batch)
+                goto fail;
+            atomic_init(&s->rx_head, 0);
+            atomic_init(&s->rx_tail, 0);
+            atomic_init(&s->rx_waiting, 0);
+            atomic_init(&s->rx_error, 0);
+        }
         ret = pthread_mutex_init(&s->mutex, NULL);
         if (ret != 0) {
             av_log(h, AV_LOG_ERROR, "pthread_mutex_init failed : %s\n", strerror(ret));
@@ -994,6 +1188,10 @@ static int udp_open(URLContext *h, const char *uri, int flags)
     if (udp_fd >= 0)
         closesocket(udp_fd);
     av_fifo_freep(&s->fifo);
+#if HAVE_PTHREAD_CANCEL
+    av_freep(&s->rx_ring);
+    av_freep(&s->rx_batch);
+#endif
     for (i = 0; i < num_include_sources; i++)
         av_freep(&include_sources[i]);
     for (i = 0; i < num_exclude_sources; i++)
@@ -1018,30 +1216,38 @@ static int udp_read(URLContext *h, uint8_t *buf, int size)
 #if HAVE_PTHREAD_CANCEL
     int avail, nonblock = h->flags & AVIO_FLAG_NONBLOCK;
 
-    if (s->fifo) {
-        pthread_mutex_lock(&s->mutex);
+    if (s->rx_ring) {
         do {
-            avail = av_fifo_size(s->fifo);
-            if (avail) { // >=size) {
+            unsigned tail = atomic_load_explicit(&s->rx_tail, memory_order_relaxed);
+            unsigned head = atomic_load(&s->rx_head);
+            if (head != tail) {
                 uint8_t tmp[4];
-
-                av_fifo_generic_read(s->fifo, tmp, 4, NULL);
-                avail= AV_RL32(tmp);
-                if(avail > size){
-                    av_log(h, AV_LOG_WARNING, "Part of datagram lost due to insufficient buffer size\n");
-                    avail= size;
-                }
-
-                av_fifo_generic_read(s->fifo, buf, avail, NULL);
-                av_fifo_drain(s->fifo, AV_RL32(tmp) - avail);
-                pthread_mutex_unlock(&s->mutex);
-                return avail;
-            } else if(s->circular_buffer_error){
-                int err = s->circular_buffer_error;
-                pthread_mutex_unlock(&s->mutex);
-                return err;
+                int len, total = 0;
+
+                /* With merge_datagrams, append the following datagrams as
+                 * long as they fit whole, for callers which do not need
+                 * the datagram boundaries. */
+                do {
+                    rx_ring_read(s, tail, tmp, 4);
+                    len = avail = AV_RL32(tmp);
+                    if (total && avail > size - total)
+                        break;
+                    tail = rx_ring_advance(s, tail, 4);
+                    if(avail > size){
+                        av_log(h, AV_LOG_WARNING, "Part of datagram lost due to insufficient buffer size\n");
+                        avail= size;
+                    }
+
+                    rx_ring_read(s, tail, buf + total, avail);
+                    tail = rx_ring_advance(s, tail, len);
+                    total += avail;
+                } while (s->merge_datagrams && tail != head && total < size);
+
+                atomic_store_explicit(&s->rx_tail, tail, memory_order_release);
+                return total;
+            } else if (atomic_load(&s->rx_error)) {
+                return atomic_load(&s->rx_error);
             } else if(nonblock) {
-                pthread_mutex_unlock(&s->mutex);
                 return AVERROR(EAGAIN);
             }
             else {
@@ -1050,10 +1256,14 @@ static int udp_read(URLContext *h, uint8_t *buf, int size)
                 int64_t t = av_gettime() + 100000;
                 struct timespec tv = { .tv_sec  =  t / 1000000,
                                        .tv_nsec = (t % 1000000) * 1000 };
-                if (pthread_cond_timedwait(&s->cond, &s->mutex, &tv) < 0) {
-                    pthread_mutex_unlock(&s->mutex);
-                    return AVERROR(errno == ETIMEDOUT ? EAGAIN : errno);
-                }
+                pthread_mutex_lock(&s->mutex);
+                atomic_store(&s->rx_waiting, 1);
+                /* the receiving thread checks rx_waiting after publishing
+                 * new datagrams, so check again before sleeping */
+                if (atomic_load(&s->rx_head) == tail && !atomic_load(&s->rx_error))
+                    pthread_cond_timedwait(&s->cond, &s->mutex, &tv);
+                atomic_store(&s->rx_waiting, 0);
+                pthread_mutex_unlock(&s->mutex);
                 nonblock = 1;
             }
         } while( 1);
@@ -1081,20 +1291,31 @@ static int udp_write(URLContext *h, const uint8_t *buf, int size)
 
         pthread_mutex_lock(&s->mutex);
 
-        /*
-          Return error if last tx failed.
-          Here we can't know on which packet error was, but it needs to know that error exists.
-        */
-        if (s->circular_buffer_error<0) {
-            int err=s->circular_buffer_error;
-            pthread_mutex_unlock(&s->mutex);
-            return err;
-        }
+        for (;;) {
+            /*
+              Return error if last tx failed.
+              Here we can't know on which packet error was, but it needs to know that error exists.
+            */
+            if (s->circular_buffer_error<0) {
+                int err=s->circular_buffer_error;
+                pthread_mutex_unlock(&s->mutex);
+                return err;
+            }
 
-        if(av_fifo_space(s->fifo) < size + 4) {
-            /* What about a partial packet tx ? */
-            pthread_mutex_unlock(&s->mutex);
-            return AVERROR(ENOMEM);
+            if (av_fifo_space(s->fifo) >= size + 4)
+                break;
+
+            if (s->bitrate || size + 4 > s->circular_buffer_size) {
+                /* What about a partial packet tx ? */
+                pthread_mutex_unlock(&s->mutex);
+                return AVERROR(ENOMEM);
+            }
+            if (h->flags & AVIO_FLAG_NONBLOCK) {
+                pthread_mutex_unlock(&s->mutex);
+                return AVERROR(EAGAIN);
+            }
+            /* without pacing, wait for the thread to send the queued packets */
+            pthread_cond_wait(&s->cond, &s->mutex);
         }
         AV_WL32(tmp, size);
         av_fifo_generic_write(s->fifo, tmp, 4, NULL); /* size of packet */
@@ -1151,6 +1372,10 @@ static int udp_close(URLContext *h)
 #endif
     closesocket(s->udp_fd);
     av_fifo_freep(&s->fifo);
+#if HAVE_PTHREAD_CANCEL
+    av_freep(&s->rx_ring);
+    av_freep(&s->rx_batch);
+#endif
     return 0;
 }
 
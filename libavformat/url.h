@@ -86,6 +86,7 @@ typedef struct URLProtocol {
     int (*url_get_multi_file_handle)(URLContext *h, int **handles,
                                      int *numhandles);
     int (*url_get_short_seek)(URLContext *h);
+    int (*url_get_map)(URLContext *h, const uint8_t **map, int64_t *size);
     int (*url_shutdown)(URLContext *h, int flags);
     int priv_data_size;
     const AVClass *priv_data_class;
@@ -257,6 +258,14 @@ int ffurl_get_multi_file_handle(URLContext *h, int **handles, int *numhandles);
  */
 int ffurl_get_short_seek(URLContext *h);
 
+/**
+ * Return a read-only mapping of the whole resource, which stays valid
+ * until the URLContext is closed.
+ *
+ * @return 0 on success or <0 if the resource is not mapped.
+ */
+int ffurl_get_map(URLContext *h, const uint8_t **map, int64_t *size);
+
 /**
  * Signal the URLContext that we are done reading or writing the stream.
  *
@@ -32,6 +32,7 @@
 #include "libavutil/opt.h"
 #include "libavutil/parseutils.h"
 #include "libavutil/pixdesc.h"
+#include "libavutil/slicethread.h"
 #include "libavutil/thread.h"
 #include "libavutil/time.h"
 #include "libavutil/time_internal.h"
@@ -50,6 +51,7 @@
 #if CONFIG_NETWORK
 #include "network.h"
 #endif
+#include "probecache.h"
 #include "riff.h"
 #include "url.h"
 
@@ -570,9 +572,12 @@ FF_DISABLE_DEPRECATION_WARNINGS
     av_strlcpy(s->filename, filename ? filename : "", sizeof(s->filename));
 FF_ENABLE_DEPRECATION_WARNINGS
 #endif
-    if ((ret = init_input(s, filename, &tmp)) < 0)
+    if (!s->pb && (ret = ff_probe_cache_open(s, filename)) < 0)
         goto fail;
     s->probe_score = ret;
+    if ((ret = init_input(s, filename, &tmp)) < 0)
+        goto fail;
+    s->probe_score = FFMAX(s->probe_score, ret);
 
     if (!s->protocol_whitelist && s->pb && s->pb->protocol_whitelist) {
         s->protocol_whitelist = av_strdup(s->pb->protocol_whitelist);
@@ -3011,9 +3016,10 @@ static int has_codec_parameters(AVStream *st, const char **errmsg_ptr)
     return 1;
 }
 
-/* returns 1 or 0 if or if not decoded data was returned, or a negative error */
+/* returns 1 or 0 if or if not decoded data was returned, or a negative error;
+ * codec_info_nb_frames is the number of packets of the stream read before avpkt */
 static int try_decode_frame(AVFormatContext *s, AVStream *st, AVPacket *avpkt,
-                            AVDictionary **options)
+                            int codec_info_nb_frames, AVDictionary **options)
 {
     AVCodecContext *avctx = st->internal->avctx;
     const AVCodec *codec;
@@ -3069,9 +3075,11 @@ static int try_decode_frame(AVFormatContext *s, AVStream *st, AVPacket *avpkt,
 
     while ((pkt.size > 0 || (!pkt.data && got_picture)) &&
            ret >= 0 &&
-           (!has_codec_parameters(st, NULL) || !has_decode_delay_been_guessed(st) ||
-            (!st->codec_info_nb_frames &&
-             (avctx->codec->capabilities & AV_CODEC_CAP_CHANNEL_CONF)))) {
+           (!has_codec_parameters(st, NULL) ||
+            (!(s->flags & AVFMT_FLAG_FAST_INFO) &&
+             (!has_decode_delay_been_guessed(st) ||
+              (!codec_info_nb_frames &&
+               (avctx->codec->capabilities & AV_CODEC_CAP_CHANNEL_CONF)))))) {
         got_picture = 0;
         if (avctx->codec_type == AVMEDIA_TYPE_VIDEO ||
             avctx->codec_type == AVMEDIA_TYPE_AUDIO) {
@@ -3562,6 +3570,92 @@ static int extract_extradata(AVStream *st, AVPacket *pkt)
     return 0;
 }
 
+#define ANALYZE_BATCH 8
+
+/** Packets of a stream waiting to be decoded by analyze_decode_worker() */
+typedef struct AnalyzeQueue {
+    AVPacket pkt[ANALYZE_BATCH];
+    int codec_info_nb_frames[ANALYZE_BATCH];
+    int nb_pkts;
+} AnalyzeQueue;
+
+/** State of the parallel decoding of avformat_find_stream_info() */
+typedef struct AnalyzeContext {
+    AVFormatContext *ic;
+    AVDictionary **options;
+    int orig_nb_streams;
+    AVSliceThread *thread;
+    AnalyzeQueue *queues;
+    unsigned int queues_size;
+    int nb_queues;
+    int nb_queued_streams;  ///< number of queues holding packets
+} AnalyzeContext;
+
+static void analyze_decode_worker(void *priv, int jobnr, int threadnr,
+                                  int nb_jobs, int nb_threads)
+{
+    AnalyzeContext *ac = priv;
+    AnalyzeQueue *q = &ac->queues[jobnr];
+    int i;
+
+    for (i = 0; i < q->nb_pkts; i++) {
+        try_decode_frame(ac->ic, ac->ic->streams[jobnr], &q->pkt[i],
+                         q->codec_info_nb_frames[i],
+                         (ac->options && jobnr < ac->orig_nb_streams) ? &ac->options[jobnr] : NULL);
+        av_packet_unref(&q->pkt[i]);
+    }
+    q->nb_pkts = 0;
+}
+
+/** Decode all the queued packets, each stream in its own job. */
+static void analyze_flush(AnalyzeContext *ac)
+{
+    if (ac->nb_queued_streams)
+        avpriv_slicethread_execute(ac->thread, ac->nb_queues, 0);
+    ac->nb_queued_streams = 0;
+}
+
+static int analyze_queue_packet(AnalyzeContext *ac, AVStream *st, AVPacket *pkt)
+{
+    AnalyzeQueue *q;
+    int ret;
+
+    if (st->index >= ac->nb_queues) {
+        int nb_queues = ac->ic->nb_streams;
+        q = av_fast_realloc(ac->queues, &ac->queues_size, nb_queues * sizeof(*q));
+        if (!q)
+            return AVERROR(ENOMEM);
+        memset(q + ac->nb_queues, 0, (nb_queues - ac->nb_queues) * sizeof(*q));
+        ac->queues    = q;
+        ac->nb_queues = nb_queues;
+    }
+
+    q = &ac->queues[st->index];
+    ret = av_packet_ref(&q->pkt[q->nb_pkts], pkt);
+    if (ret < 0)
+        return ret;
+    if (!q->nb_pkts)
+        ac->nb_queued_streams++;
+    q->codec_info_nb_frames[q->nb_pkts++] = st->codec_info_nb_frames;
+    /* Decode as soon as every stream has a packet, so that the streams
+     * are decoded in parallel without reading much more than needed. */
+    if (q->nb_pkts == ANALYZE_BATCH || ac->nb_queued_streams == ac->ic->nb_streams)
+        analyze_flush(ac);
+    return 0;
+}
+
+static void analyze_uninit(AnalyzeContext *ac)
+{
+    int i, j;
+
+    for (i = 0; i < ac->nb_queues; i++)
+        for (j = 0; j < ac->queues[i].nb_pkts; j++)
+            av_packet_unref(&ac->queues[i].pkt[j]);
+    av_freep(&ac->queues);
+    ac->nb_queues = 0;
+    avpriv_slicethread_free(&ac->thread);
+}
+
 int avformat_find_stream_info(AVFormatContext *ic, AVDictionary **options)
 {
     int i, count = 0, ret = 0, j;
@@ -3579,9 +3673,24 @@ int avformat_find_stream_info(AVFormatContext *ic, AVDictionary **options)
     int64_t probesize = ic->probesize;
     int eof_reached = 0;
     int *missing_streams = av_opt_ptr(ic->iformat->priv_class, ic->priv_data, "missing_streams");
+    AnalyzeContext ac = { .ic = ic, .options = options, .orig_nb_streams = ic->nb_streams };
 
     flush_codecs = probesize > 0;
 
+    ret = ff_probe_cache_apply(ic);
+    if (ret < 0)
+        goto find_stream_info_err;
+    if (ret) {
+        av_log(ic, AV_LOG_DEBUG, "Stream parameters set from the probe cache\n");
+        ret = 0;
+        goto update_streams;
+    }
+
+    if (ic->analyze_threads != 1 &&
+        avpriv_slicethread_create(&ac.thread, &ac, analyze_decode_worker, NULL,
+                                  ic->analyze_threads) <= 1)
+        avpriv_slicethread_free(&ac.thread);
+
     av_opt_set(ic, "skip_clear", "1", AV_OPT_SEARCH_CHILDREN);
 
     max_stream_analyze_duration = max_analyze_duration;
@@ -3709,6 +3818,9 @@ FF_ENABLE_DEPRECATION_WARNINGS
                 fps_analyze_framecount *= 2;
             if (!tb_unreliable(st->internal->avctx))
                 fps_analyze_framecount = 0;
+            if ((ic->flags & AVFMT_FLAG_FAST_INFO) &&
+                (st->avg_frame_rate.num || st->r_frame_rate.num))
+                fps_analyze_framecount = 0;
             if (ic->fps_probe_size >= 0)
                 fps_analyze_framecount = ic->fps_probe_size;
             if (st->disposition & AV_DISPOSITION_ATTACHED_PIC)
@@ -3724,7 +3836,8 @@ FF_ENABLE_DEPRECATION_WARNINGS
             }
             // Look at the first 3 frames if there is evidence of frame delay
             // but the decoder delay is not set.
-            if (st->info->frame_delay_evidence && count < 2 && st->internal->avctx->has_b_frames == 0)
+            if (st->info->frame_delay_evidence && count < 2 && st->internal->avctx->has_b_frames == 0 &&
+                !(ic->flags & AVFMT_FLAG_FAST_INFO))
                 break;
             if (!st->internal->avctx->extradata &&
                 (!st->internal->extract_extradata.inited ||
@@ -3898,8 +4011,13 @@ FF_ENABLE_DEPRECATION_WARNINGS
          * least one frame of codec data, this makes sure the codec initializes
          * the channel configuration and does not only trust the values from
          * the container. */
-        try_decode_frame(ic, st, pkt,
-                         (options && i < orig_nb_streams) ? &options[i] : NULL);
+        if (ac.thread) {
+            ret = analyze_queue_packet(&ac, st, pkt);
+            if (ret < 0)
+                goto find_stream_info_err;
+        } else
+            try_decode_frame(ic, st, pkt, st->codec_info_nb_frames,
+                             (options && i < orig_nb_streams) ? &options[i] : NULL);
 
         if (ic->flags & AVFMT_FLAG_NOBUFFER)
             av_packet_unref(pkt);
@@ -3908,6 +4026,9 @@ FF_ENABLE_DEPRECATION_WARNINGS
         count++;
     }
 
+    if (ac.thread)
+        analyze_flush(&ac);
+
     if (eof_reached) {
         int stream_index;
         for (stream_index = 0; stream_index < ic->nb_streams; stream_index++) {
@@ -3946,7 +4067,7 @@ FF_ENABLE_DEPRECATION_WARNINGS
             /* flush the decoders */
             if (st->info->found_decoder == 1) {
                 do {
-                    err = try_decode_frame(ic, st, &empty_pkt,
+                    err = try_decode_frame(ic, st, &empty_pkt, st->codec_info_nb_frames,
                                             (options && i < orig_nb_streams)
                                             ? &options[i] : NULL);
                 } while (err > 0 && !has_codec_parameters(st, NULL));
@@ -4086,6 +4207,7 @@ FF_ENABLE_DEPRECATION_WARNINGS
         }
     }
 
+update_streams:
     compute_chapters_end(ic);
 
     /* update the stream parameters from the internal codec contexts */
@@ -4148,7 +4270,11 @@ FF_ENABLE_DEPRECATION_WARNINGS
         st->internal->avctx_inited = 0;
     }
 
+    if (ret >= 0)
+        ff_probe_cache_store(ic);
+
 find_stream_info_err:
+    analyze_uninit(&ac);
     for (i = 0; i < ic->nb_streams; i++) {
         st = ic->streams[i];
         if (st->info)
@@ -4400,6 +4526,7 @@ void avformat_free_context(AVFormatContext *s)
     if (s->oformat && s->oformat->priv_class && s->priv_data)
         av_opt_free(s->priv_data);
 
+    ff_interleave_queue_free(s);
     for (i = s->nb_streams - 1; i >= 0; i--)
         ff_free_stream(s, s->streams[i]);
 
@@ -4418,6 +4545,7 @@ void avformat_free_context(AVFormatContext *s)
     av_freep(&s->chapters);
     av_dict_free(&s->metadata);
     av_dict_free(&s->internal->id3v2_meta);
+    ff_probe_cache_free(&s->internal->probe_cache);
     av_freep(&s->streams);
     flush_packet_queue(s);
     av_freep(&s->internal);
@@ -231,6 +231,9 @@ AVBufferPool *av_buffer_pool_init2(int size, void *opaque,
     pool->pool_free = pool_free;
 
     atomic_init(&pool->refcount, 1);
+#if POOL_LOCKLESS
+    atomic_init(&pool->free_top, 0);
+#endif
 
     return pool;
 }
@@ -247,16 +250,97 @@ AVBufferPool *av_buffer_pool_init(int size, AVBufferRef* (*alloc)(int size))
     pool->alloc    = alloc ? alloc : av_buffer_alloc;
 
     atomic_init(&pool->refcount, 1);
+#if POOL_LOCKLESS
+    atomic_init(&pool->free_top, 0);
+#endif
 
     return pool;
 }
 
+#if POOL_LOCKLESS
+static BufferPoolEntry *pool_entry(AVBufferPool *pool, unsigned index)
+{
+    int chunk = av_log2(index + 1);
+    return &pool->chunks[chunk][index + 1 - (1U << chunk)];
+}
+
+/* must be called with the pool mutex held */
+static BufferPoolEntry *pool_entry_alloc(AVBufferPool *pool)
+{
+    unsigned index = pool->nb_entries;
+    BufferPoolEntry *buf;
+    int chunk;
+
+    if (index == UINT_MAX)
+        return NULL;
+    chunk = av_log2(index + 1);
+    if (!pool->chunks[chunk]) {
+        pool->chunks[chunk] = av_mallocz_array(1U << chunk, sizeof(**pool->chunks));
+        if (!pool->chunks[chunk])
+            return NULL;
+    }
+    buf = pool_entry(pool, index);
+    buf->index = index;
+    atomic_init(&buf->next_index, 0);
+    pool->nb_entries++;
+
+    return buf;
+}
+
+static void pool_push(AVBufferPool *pool, BufferPoolEntry *buf)
+{
+    unsigned long long top = atomic_load_explicit(&pool->free_top,
+                                                  memory_order_relaxed);
+    unsigned long long new_top;
+
+    do {
+        atomic_store_explicit(&buf->next_index, top & 0xFFFFFFFF,
+                              memory_order_relaxed);
+        new_top = ((top & ~0xFFFFFFFFULL) + (1ULL << 32)) | (buf->index + 1);
+    } while (!atomic_compare_exchange_weak_explicit(&pool->free_top, &top, new_top,
+                                                    memory_order_release,
+                                                    memory_order_relaxed));
+}
+
+static BufferPoolEntry *pool_pop(AVBufferPool *pool)
+{
+    unsigned long long top = atomic_load_explicit(&pool->free_top,
+                                                  memory_order_acquire);
+    unsigned long long new_top;
+    BufferPoolEntry *buf;
+
+    do {
+        unsigned index = top & 0xFFFFFFFF;
+        if (!index)
+            return NULL;
+        /* entries are never freed before the pool, so buf may be read even
+         * if another thread pops it first; the tag then makes the CAS fail */
+        buf     = pool_entry(pool, index - 1);
+        new_top = ((top & ~0xFFFFFFFFULL) + (1ULL << 32)) |
+                  atomic_load_explicit(&buf->next_index, memory_order_relaxed);
+    } while (!atomic_compare_exchange_weak_explicit(&pool->free_top, &top, new_top,
+                                                    memory_order_acquire,
+                                                    memory_order_acquire));
+    return buf;
+}
+#endif
+
 /*
  * This function gets called when the pool has been uninited and
  * all the buffers returned to it.
  */
 static void buffer_pool_free(AVBufferPool *pool)
 {
+#if POOL_LOCKLESS
+    unsigned i;
+
+    for (i = 0; i < pool->nb_entries; i++) {
+        BufferPoolEntry *buf = pool_entry(pool, i);
+        buf->free(buf->opaque, buf->data);
+    }
+    for (i = 0; i < POOL_MAX_CHUNKS; i++)
+        av_freep(&pool->chunks[i]);
+#else
     while (pool->pool) {
         BufferPoolEntry *buf = pool->pool;
         pool->pool = buf->next;
@@ -264,6 +348,7 @@ static void buffer_pool_free(AVBufferPool *pool)
         buf->free(buf->opaque, buf->data);
         av_freep(&buf);
     }
+#endif
     ff_mutex_destroy(&pool->mutex);
 
     if (pool->pool_free)
@@ -293,10 +378,14 @@ static void pool_release_buffer(void *opaque, uint8_t *data)
     if(CONFIG_MEMORY_POISONING)
         memset(buf->data, FF_MEMORY_POISON, pool->size);
 
+#if POOL_LOCKLESS
+    pool_push(pool, buf);
+#else
     ff_mutex_lock(&pool->mutex);
     buf->next = pool->pool;
     pool->pool = buf;
     ff_mutex_unlock(&pool->mutex);
+#endif
 
     if (atomic_fetch_add_explicit(&pool->refcount, -1, memory_order_acq_rel) == 1)
         buffer_pool_free(pool);
@@ -314,7 +403,11 @@ static AVBufferRef *pool_alloc_buffer(AVBufferPool *pool)
     if (!ret)
         return NULL;
 
+#if POOL_LOCKLESS
+    buf = pool_entry_alloc(pool);
+#else
     buf = av_mallocz(sizeof(*buf));
+#endif
     if (!buf) {
         av_buffer_unref(&ret);
         return NULL;
@@ -336,6 +429,20 @@ AVBufferRef *av_buffer_pool_get(AVBufferPool *pool)
     AVBufferRef *ret;
     BufferPoolEntry *buf;
 
+#if POOL_LOCKLESS
+    buf = pool_pop(pool);
+    if (buf) {
+        ret = av_buffer_create(buf->data, pool->size, pool_release_buffer,
+                               buf, 0);
+        if (!ret)
+            pool_push(pool, buf);
+    } else {
+        /* allocators may rely on being serialized by the pool */
+        ff_mutex_lock(&pool->mutex);
+        ret = pool_alloc_buffer(pool);
+        ff_mutex_unlock(&pool->mutex);
+    }
+#else
     ff_mutex_lock(&pool->mutex);
     buf = pool->pool;
     if (buf) {
@@ -349,6 +456,7 @@ AVBufferRef *av_buffer_pool_get(AVBufferPool *pool)
         ret = pool_alloc_buffer(pool);
     }
     ff_mutex_unlock(&pool->mutex);
+#endif
 
     if (ret)
         atomic_fetch_add_explicit(&pool->refcount, 1, memory_order_relaxed);
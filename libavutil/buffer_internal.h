@@ -59,6 +59,23 @@ struct AVBuffer {
     int flags;
 };
 
+/**
+ * The free buffers of a pool are kept in a lock-free stack when 64-bit
+ * atomic operations are natively available, and in a mutex protected
+ * linked list otherwise.
+ */
+#if defined(ATOMIC_LLONG_LOCK_FREE) && ATOMIC_LLONG_LOCK_FREE == 2
+#define POOL_LOCKLESS 1
+#else
+#define POOL_LOCKLESS 0
+#endif
+
+/**
+ * Entries of a lockless pool are stored in chunks of growing size, the i-th
+ * chunk holding 2^i entries, so that they never move once allocated.
+ */
+#define POOL_MAX_CHUNKS 32
+
 typedef struct BufferPoolEntry {
     uint8_t *data;
 
@@ -71,12 +88,29 @@ typedef struct BufferPoolEntry {
 
     AVBufferPool *pool;
     struct BufferPoolEntry *next;
+
+#if POOL_LOCKLESS
+    unsigned index;             ///< position of this entry in the pool
+    atomic_uint next_index;     ///< index + 1 of the next free entry, 0 for none
+#endif
 } BufferPoolEntry;
 
 struct AVBufferPool {
     AVMutex mutex;
     BufferPoolEntry *pool;
 
+#if POOL_LOCKLESS
+    /*
+     * Top of the stack of free entries: index + 1 of the entry in the low
+     * 32 bits (0 when the stack is empty), and in the high 32 bits a tag
+     * incremented on every update, which protects against the ABA problem.
+     */
+    atomic_ullong free_top;
+    /* Allocated entries, written under mutex. */
+    BufferPoolEntry *chunks[POOL_MAX_CHUNKS];
+    unsigned nb_entries;
+#endif
+
     /*
      * This is used to track when the pool is to be freed.
      * The pointer to the pool itself held by the caller is considered to
@@ -27,9 +27,23 @@
 #include "time_internal.h"
 #include "bprint.h"
 
+/* number of entries above which a hash index of the keys is maintained */
+#define HASH_THRESHOLD 16
+
 struct AVDictionary {
     int count;
     AVDictionaryEntry *elems;
+
+    /*
+     * Optional hash index of the keys. The hash is computed on the upper
+     * case key, so that it can serve both case sensitive and insensitive
+     * lookups. buckets[] and chain[] hold element index + 1, 0 ending a
+     * chain; both have hash_size entries, which is always a power of two
+     * larger than count.
+     */
+    unsigned *buckets;
+    unsigned *chain;
+    unsigned hash_size;
 };
 
 int av_dict_count(const AVDictionary *m)
@@ -37,6 +51,87 @@ int av_dict_count(const AVDictionary *m)
     return m ? m->count : 0;
 }
 
+static unsigned dict_hash(const char *key)
+{
+    unsigned h = 2166136261U;
+
+    for (; *key; key++)
+        h = (h ^ av_toupper(*key)) * 16777619U;
+    return h;
+}
+
+static void dict_index_free(AVDictionary *m)
+{
+    av_freep(&m->buckets);
+    av_freep(&m->chain);
+    m->hash_size = 0;
+}
+
+static void dict_index_link(AVDictionary *m, unsigned i, const char *key)
+{
+    unsigned h = dict_hash(key) & (m->hash_size - 1);
+
+    m->chain[i]   = m->buckets[h];
+    m->buckets[h] = i + 1;
+}
+
+static void dict_index_unlink(AVDictionary *m, unsigned i)
+{
+    unsigned *p = &m->buckets[dict_hash(m->elems[i].key) & (m->hash_size - 1)];
+
+    while (*p != i + 1)
+        p = &m->chain[*p - 1];
+    *p = m->chain[i];
+}
+
+/* Must be called after the element count-1 has been appended. */
+static void dict_index_add(AVDictionary *m)
+{
+    unsigned size, i;
+
+    /* once built, the index is kept even if count drops below the threshold */
+    if (!m->hash_size && m->count < HASH_THRESHOLD)
+        return;
+    if (m->count < m->hash_size) {
+        dict_index_link(m, m->count - 1, m->elems[m->count - 1].key);
+        return;
+    }
+
+    /*
+     * (re)build the index; on allocation failure, fall back to linear search.
+     * The size depends only on count, as hash_size is 0 after such a failure.
+     */
+    for (size = HASH_THRESHOLD * 2; size < 2U * m->count; size *= 2)
+        ;
+    dict_index_free(m);
+    m->buckets = av_mallocz_array(size, sizeof(*m->buckets));
+    m->chain   = av_malloc_array(size, sizeof(*m->chain));
+    if (!m->buckets || !m->chain) {
+        dict_index_free(m);
+        return;
+    }
+    m->hash_size = size;
+    for (i = 0; i < m->count; i++)
+        dict_index_link(m, i, m->elems[i].key);
+}
+
+/*
+ * Must be called before the element i is removed by replacing it with the
+ * last element.
+ */
+static void dict_index_remove(AVDictionary *m, unsigned i)
+{
+    unsigned last = m->count - 1;
+
+    if (!m->hash_size)
+        return;
+    dict_index_unlink(m, i);
+    if (i != last) {
+        dict_index_unlink(m, last);
+        dict_index_link(m, i, m->elems[last].key);
+    }
+}
+
 AVDictionaryEntry *av_dict_get(const AVDictionary *m, const char *key,
                                const AVDictionaryEntry *prev, int flags)
 {
@@ -50,6 +145,21 @@ AVDictionaryEntry *av_dict_get(const AVDictionary *m, const char *key,
     else
         i = 0;
 
+    if (m->hash_size && !(flags & AV_DICT_IGNORE_SUFFIX)) {
+        AVDictionaryEntry *found = NULL;
+
+        /* chains are not ordered, so look for the first match after prev */
+        for (j = m->buckets[dict_hash(key) & (m->hash_size - 1)]; j; j = m->chain[j - 1]) {
+            AVDictionaryEntry *e = &m->elems[j - 1];
+            if (j - 1 < i || (found && e > found))
+                continue;
+            if (flags & AV_DICT_MATCH_CASE ? strcmp(e->key, key) : av_strcasecmp(e->key, key))
+                continue;
+            found = e;
+        }
+        return found;
+    }
+
     for (; i < m->count; i++) {
         const char *s = m->elems[i].key;
         if (flags & AV_DICT_MATCH_CASE)
@@ -100,6 +210,7 @@ int av_dict_set(AVDictionary **pm, const char *key, const char *value,
             oldval = tag->value;
         else
             av_free(tag->value);
+        dict_index_remove(m, tag - m->elems);
         av_free(tag->key);
         *tag = m->elems[--m->count];
     } else if (copy_value) {
@@ -124,10 +235,12 @@ int av_dict_set(AVDictionary **pm, const char *key, const char *value,
             av_freep(&copy_value);
         }
         m->count++;
+        dict_index_add(m);
     } else {
         av_freep(&copy_key);
     }
     if (!m->count) {
+        dict_index_free(m);
         av_freep(&m->elems);
         av_freep(pm);
     }
@@ -136,6 +249,7 @@ int av_dict_set(AVDictionary **pm, const char *key, const char *value,
 
 err_out:
     if (m && !m->count) {
+        dict_index_free(m);
         av_freep(&m->elems);
         av_freep(pm);
     }
@@ -210,6 +324,7 @@ void av_dict_free(AVDictionary **pm)
             av_freep(&m->elems[m->count].value);
         }
         av_freep(&m->elems);
+        dict_index_free(m);
     }
     av_freep(pm);
 }
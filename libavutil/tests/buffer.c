@@ -0,0 +1,127 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/*
+ * This test program hammers a single AVBufferPool from several threads and
+ * checks that no buffer is ever handed out to two users at the same time.
+ *
+ * Usage: buffer [threads [iterations]]
+ * When arguments are given, the achieved throughput is printed, so that the
+ * program can be used as a benchmark of the pool.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "libavutil/buffer.h"
+#include "libavutil/common.h"
+#include "libavutil/thread.h"
+#include "libavutil/time.h"
+
+#define MAX_THREADS   64
+#define BUFS_PER_ITER 4
+#define BUF_SIZE      64
+
+typedef struct ThreadData {
+    pthread_t thread;
+    AVBufferPool *pool;
+    int id;
+    int iterations;
+    int errors;
+} ThreadData;
+
+static void *thread_main(void *arg)
+{
+    ThreadData *td = arg;
+    AVBufferRef *bufs[BUFS_PER_ITER];
+    int i, j, k;
+
+    for (i = 0; i < td->iterations; i++) {
+        for (j = 0; j < BUFS_PER_ITER; j++) {
+            bufs[j] = av_buffer_pool_get(td->pool);
+            if (!bufs[j]) {
+                td->errors++;
+                break;
+            }
+            memset(bufs[j]->data, td->id * BUFS_PER_ITER + j, BUF_SIZE);
+        }
+        for (k = 0; k < j; k++) {
+            int l;
+            for (l = 0; l < BUF_SIZE; l++) {
+                if (bufs[k]->data[l] != (uint8_t)(td->id * BUFS_PER_ITER + k)) {
+                    td->errors++;
+                    break;
+                }
+            }
+            av_buffer_unref(&bufs[k]);
+        }
+    }
+    return NULL;
+}
+
+int main(int argc, char **argv)
+{
+    ThreadData td[MAX_THREADS];
+    AVBufferPool *pool;
+    int nb_threads = argc > 1 ? atoi(argv[1]) : 4;
+    int iterations = argc > 2 ? atoi(argv[2]) : 10000;
+    int64_t start, elapsed;
+    int i, ret, errors = 0;
+
+    if (nb_threads < 1 || nb_threads > MAX_THREADS || iterations < 1) {
+        fprintf(stderr, "Usage: %s [threads (1-%d) [iterations]]\n",
+                argv[0], MAX_THREADS);
+        return 1;
+    }
+
+    pool = av_buffer_pool_init(BUF_SIZE, NULL);
+    if (!pool)
+        return 1;
+
+    start = av_gettime_relative();
+    for (i = 0; i < nb_threads; i++) {
+        td[i].pool       = pool;
+        td[i].id         = i;
+        td[i].iterations = iterations;
+        td[i].errors     = 0;
+        if ((ret = pthread_create(&td[i].thread, NULL, thread_main, &td[i]))) {
+            fprintf(stderr, "pthread_create failed: %s.\n", strerror(ret));
+            return 1;
+        }
+    }
+    for (i = 0; i < nb_threads; i++) {
+        pthread_join(td[i].thread, NULL);
+        errors += td[i].errors;
+    }
+    elapsed = av_gettime_relative() - start;
+
+    av_buffer_pool_uninit(&pool);
+
+    if (argc > 1)
+        printf("%d threads: %.0f get/unref per second\n", nb_threads,
+               (double)nb_threads * iterations * BUFS_PER_ITER * 1000000 /
+               FFMAX(elapsed, 1));
+
+    if (errors) {
+        fprintf(stderr, "%d errors\n", errors);
+        return 2;
+    }
+
+    return 0;
+}
@@ -49,6 +49,110 @@ static void test_separators(const AVDictionary *m, const char pair, const char v
     av_dict_free(&dict);
 }
 
+/* compare lookups through the hash index against a linear search */
+static int check_index(AVDictionary *m, const char *key, int flags)
+{
+    AVDictionaryEntry *e1 = NULL, *e2 = NULL;
+    unsigned hash_size = m->hash_size;
+    int n = 0;
+
+    do {
+        e1 = av_dict_get(m, key, e1, flags);
+        m->hash_size = 0;
+        e2 = av_dict_get(m, key, e2, flags);
+        m->hash_size = hash_size;
+        if (e1 != e2)
+            return -1;
+    } while (e1 && ++n);
+
+    return n;
+}
+
+static void test_index(void)
+{
+    AVDictionary *dict = NULL;
+    AVDictionaryEntry *e;
+    char key[16];
+    int i, n = 0, errors = 0;
+
+    for (i = 0; i < 200; i++) {
+        snprintf(key, sizeof(key), i & 1 ? "Key%d" : "key%d", i);
+        av_dict_set_int(&dict, key, i, 0);
+    }
+    for (i = 0; i < 200; i += 3) {
+        snprintf(key, sizeof(key), "KEY%d", i);
+        av_dict_set(&dict, key, "overwritten", 0);
+    }
+    for (i = 0; i < 200; i += 5) {
+        snprintf(key, sizeof(key), "key%d", i);
+        av_dict_set(&dict, key, NULL, 0);
+    }
+    for (i = 0; i < 4; i++)
+        av_dict_set_int(&dict, "key7", i, AV_DICT_MULTIKEY);
+
+    for (i = 0; i < 210; i++) {
+        int ret;
+        snprintf(key, sizeof(key), "kEy%d", i);
+        ret = check_index(dict, key, 0);
+        errors += ret < 0 || check_index(dict, key, AV_DICT_MATCH_CASE) < 0;
+        n += FFMAX(ret, 0);
+    }
+    printf("%d entries, %d matches, %d errors\n", av_dict_count(dict), n, errors);
+    e = NULL;
+    while ((e = av_dict_get(dict, "key7", e, 0)))
+        printf("%s %s\n", e->key, e->value);
+    e = av_dict_get(dict, "KEY9", NULL, 0);
+    printf("%s %s\n", e->key, e->value);
+    e = av_dict_get(dict, "KEY9", NULL, AV_DICT_MATCH_CASE);
+    printf("%s %s\n", e->key, e->value);
+
+    while (dict) {
+        e = av_dict_get(dict, "", NULL, AV_DICT_IGNORE_SUFFIX);
+        av_dict_set(&dict, e->key, NULL, 0);
+    }
+
+    /* the index must be rebuilt properly after its allocation failed */
+    errors = n = 0;
+    for (i = 0; i < 200; i++) {
+        snprintf(key, sizeof(key), "key%d", i);
+        av_dict_set_int(&dict, key, i, 0);
+        if (i == 40 || i == 150)
+            dict_index_free(dict);
+        if (dict->hash_size && dict->hash_size <= dict->count)
+            errors++;
+    }
+    for (i = 0; i < 200; i++) {
+        snprintf(key, sizeof(key), "KEY%d", i);
+        errors += check_index(dict, key, 0) != 1;
+        e = av_dict_get(dict, key, NULL, 0);
+        n += e && atoi(e->value) == i;
+    }
+    printf("%d entries, %d matches, %d errors\n", av_dict_count(dict), n, errors);
+    av_dict_free(&dict);
+
+    /* overwrite and add entries after the count dropped below the threshold */
+    for (i = 0; i < HASH_THRESHOLD; i++) {
+        snprintf(key, sizeof(key), "k%d", i);
+        av_dict_set_int(&dict, key, i, 0);
+    }
+    av_dict_set(&dict, "k0", NULL, 0);
+    av_dict_set(&dict, "k1", NULL, 0);
+    av_dict_set(&dict, "k5", "overwritten", 0);
+    av_dict_set(&dict, "fresh", "added", 0);
+    errors = 0;
+    for (i = 0; i < HASH_THRESHOLD; i++) {
+        snprintf(key, sizeof(key), "k%d", i);
+        errors += check_index(dict, key, 0) != (i > 1);
+    }
+    errors += check_index(dict, "fresh", 0) != 1;
+    e = av_dict_get(dict, "k5", NULL, 0);
+    printf("%s %s\n", e ? e->key : "(null)", e ? e->value : "(null)");
+    e = av_dict_get(dict, "fresh", NULL, 0);
+    printf("%s %s\n", e ? e->key : "(null)", e ? e->value : "(null)");
+    printf("%d entries, %d errors\n", av_dict_count(dict), errors);
+    av_dict_free(&dict);
+}
+
 int main(void)
 {
     AVDictionary *dict = NULL;
@@ -132,5 +236,8 @@ int main(void)
     printf("%s\n", e->value);
     av_dict_free(&dict);
 
+    printf("\nTesting hash indexed av_dict_get()\n");
+    test_index();
+
     return 0;
 }
@@ -81,6 +81,17 @@ int av_gettime_relative_is_monotonic(void)
 #endif
 }
 
+int64_t av_gettime_thread_cpu(void)
+{
+#if HAVE_CLOCK_GETTIME && defined(CLOCK_THREAD_CPUTIME_ID)
+    struct timespec ts;
+
+    if (!clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts))
+        return (int64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+#endif
+    return 0;
+}
+
 int av_usleep(unsigned usec)
 {
 #if HAVE_NANOSLEEP
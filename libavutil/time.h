@@ -43,6 +43,16 @@ int64_t av_gettime_relative(void);
  */
 int av_gettime_relative_is_monotonic(void);
 
+/**
+ * Get the CPU time consumed by the calling thread, in microseconds.
+ *
+ * This is meant for measuring durations: only the difference between two
+ * values returned to the same thread is meaningful.
+ *
+ * @return the thread CPU time, or 0 if the platform does not provide it
+ */
+int64_t av_gettime_thread_cpu(void);
+
 /**
  * Sleep for a period of time.  Although the duration is expressed in
  * microseconds, the actual delay may be rounded to the precision of the
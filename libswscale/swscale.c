@@ -236,6 +236,7 @@ static int swscale(SwsContext *c, const uint8_t *src[],
      * and faster */
     const int dstW                   = c->dstW;
     const int dstH                   = c->dstH;
+    const int dstEnd                 = c->dstSliceH ? c->dstSliceY + c->dstSliceH : dstH;
 
     const enum AVPixelFormat dstFormat = c->dstFormat;
     const int flags                  = c->flags;
@@ -337,7 +338,7 @@ static int swscale(SwsContext *c, const uint8_t *src[],
     if (srcSliceY == 0) {
         lumBufIndex  = -1;
         chrBufIndex  = -1;
-        dstY         = 0;
+        dstY         = c->dstSliceY;
         lastInLumBuf = -1;
         lastInChrBuf = -1;
     }
@@ -369,7 +370,7 @@ static int swscale(SwsContext *c, const uint8_t *src[],
         hout_slice->width = dstW;
     }
 
-    for (; dstY < dstH; dstY++) {
+    for (; dstY < dstEnd; dstY++) {
         const int chrDstY = dstY >> c->chrDstVSubSample;
         int use_mmx_vfilter= c->use_mmx_vfilter;
 
@@ -746,6 +747,62 @@ static void rgb48Toxyz12(struct SwsContext *c, uint16_t *dst,
     }
 }
 
+void ff_sws_slice_worker(void *priv, int jobnr, int threadnr,
+                         int nb_jobs, int nb_threads)
+{
+    SwsContext *parent = priv;
+    SwsContext *c      = parent->slice_ctx[jobnr];
+    const int align    = 1 << c->chrDstVSubSample;
+    const uint8_t *src[4];
+    uint8_t *dst[4];
+    int srcStride[4], dstStride[4];
+    int dstY0, dstY1;
+
+    /* keep chroma lines within a single band */
+    dstY0 = jobnr ? FFALIGN(c->dstH * (int64_t)jobnr / nb_jobs, align) : 0;
+    dstY1 = jobnr < nb_jobs - 1 ?
+            FFALIGN(c->dstH * (int64_t)(jobnr + 1) / nb_jobs, align) : c->dstH;
+    dstY1 = FFMIN(dstY1, c->dstH);
+    if (dstY0 >= dstY1) {
+        parent->slice_err[jobnr] = 0;
+        return;
+    }
+
+    /* swscale() modifies the pointers and strides it is given */
+    memcpy(src,       parent->slice_src,       sizeof(src));
+    memcpy(srcStride, parent->slice_srcStride, sizeof(srcStride));
+    memcpy(dst,       parent->slice_dst,       sizeof(dst));
+    memcpy(dstStride, parent->slice_dstStride, sizeof(dstStride));
+    memcpy(c->pal_yuv, parent->pal_yuv, sizeof(c->pal_yuv));
+    memcpy(c->pal_rgb, parent->pal_rgb, sizeof(c->pal_rgb));
+
+    c->dstSliceY = dstY0;
+    c->dstSliceH = dstY1 - dstY0;
+    parent->slice_err[jobnr] = c->swscale(c, src, srcStride, 0, c->srcH,
+                                          dst, dstStride);
+}
+
+static int scale_threaded(SwsContext *c, const uint8_t *src[], int srcStride[],
+                          uint8_t *dst[], int dstStride[])
+{
+    int i, ret = 0;
+
+    memcpy(c->slice_src,       src,       sizeof(c->slice_src));
+    memcpy(c->slice_srcStride, srcStride, sizeof(c->slice_srcStride));
+    memcpy(c->slice_dst,       dst,       sizeof(c->slice_dst));
+    memcpy(c->slice_dstStride, dstStride, sizeof(c->slice_dstStride));
+
+    avpriv_slicethread_execute(c->slicethread, c->nb_slice_ctx, 0);
+
+    for (i = 0; i < c->nb_slice_ctx; i++) {
+        if (c->slice_err[i] < 0)
+            return c->slice_err[i];
+        ret += c->slice_err[i];
+    }
+    c->dstY = c->dstH;
+    return ret;
+}
+
 /**
  * swscale wrapper, so we don't need to export the SwsContext.
  * Assumes planar YUV to be in YUV order instead of YVU.
@@ -977,7 +1034,10 @@ int attribute_align_arg sws_scale(struct SwsContext *c,
     /* reset slice direction at end of frame */
     if (srcSliceY_internal + srcSliceH == c->srcH)
         c->sliceDir = 0;
-    ret = c->swscale(c, src2, srcStride2, srcSliceY_internal, srcSliceH, dst2, dstStride2);
+    if (c->nb_slice_ctx && srcSliceY_internal == 0 && srcSliceH == c->srcH)
+        ret = scale_threaded(c, src2, srcStride2, dst2, dstStride2);
+    else
+        ret = c->swscale(c, src2, srcStride2, srcSliceY_internal, srcSliceH, dst2, dstStride2);
 
 
     if (c->dstXYZ && !(c->srcXYZ && c->srcW==c->dstW && c->srcH==c->dstH)) {
@@ -31,6 +31,7 @@
 #include "libavutil/log.h"
 #include "libavutil/pixfmt.h"
 #include "libavutil/pixdesc.h"
+#include "libavutil/slicethread.h"
 #include "libavutil/ppc/util_altivec.h"
 
 #define STR(s) AV_TOSTRING(s) // AV_STRINGIFY is too long
@@ -321,6 +322,21 @@ typedef struct SwsContext {
     uint8_t *cascaded1_tmp[4];
     int cascaded_mainindex;
 
+    /* The slice_* fields allow splitting the output of a whole picture into
+     * horizontal bands, each scaled by its own context on a worker thread.
+     */
+    int nb_threads;               ///< Number of threads requested by the user, 0 for auto.
+    AVSliceThread *slicethread;
+    struct SwsContext **slice_ctx;
+    int nb_slice_ctx;
+    int *slice_err;
+    const uint8_t *slice_src[4];
+    int slice_srcStride[4];
+    uint8_t *slice_dst[4];
+    int slice_dstStride[4];
+    int dstSliceY;                ///< First destination line output by this context, when scaling a band.
+    int dstSliceH;                ///< Number of destination lines output by this context, 0 for all.
+
     double gamma_value;
     int gamma_flag;
     int is_internal_gamma;
@@ -849,6 +865,13 @@ void ff_get_unscaled_swscale_aarch64(SwsContext *c);
  */
 SwsFunc ff_getSwsFunc(SwsContext *c);
 
+/**
+ * Scale one horizontal band of the destination picture, see
+ * SwsContext.slice_ctx. Used as an avpriv_slicethread worker.
+ */
+void ff_sws_slice_worker(void *priv, int jobnr, int threadnr,
+                         int nb_jobs, int nb_threads);
+
 void ff_sws_init_input_funcs(SwsContext *c);
 void ff_sws_init_output_funcs(SwsContext *c,
                               yuv2planar1_fn *yuv2plane1,
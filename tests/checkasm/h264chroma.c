@@ -0,0 +1,83 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with FFmpeg; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <string.h>
+#include "checkasm.h"
+#include "libavcodec/h264chroma.h"
+#include "libavutil/common.h"
+#include "libavutil/internal.h"
+#include "libavutil/intreadwrite.h"
+
+static const uint32_t pixel_mask[3] = { 0xffffffff, 0x01ff01ff, 0x03ff03ff };
+
+#define SIZEOF_PIXEL ((bit_depth + 7) / 8)
+#define STRIDE       (2 * 16)
+#define BUF_SIZE     (STRIDE * (16 + 1))
+
+#define randomize_buffers()                        \
+    do {                                           \
+        uint32_t mask = pixel_mask[bit_depth - 8]; \
+        int k;                                     \
+        for (k = 0; k < BUF_SIZE; k += 4) {        \
+            uint32_t r = rnd() & mask;             \
+            AV_WN32A(src + k, rnd() & mask);       \
+            AV_WN32A(dst0 + k, r);                 \
+            AV_WN32A(dst1 + k, r);                 \
+        }                                          \
+    } while (0)
+
+void checkasm_check_h264chroma(void)
+{
+    LOCAL_ALIGNED_16(uint8_t, src,  [BUF_SIZE]);
+    LOCAL_ALIGNED_16(uint8_t, dst0, [BUF_SIZE]);
+    LOCAL_ALIGNED_16(uint8_t, dst1, [BUF_SIZE]);
+    H264ChromaContext h;
+    int op, bit_depth, i, j;
+    declare_func_emms(AV_CPU_FLAG_MMX, void, uint8_t *dst, uint8_t *src,
+                      ptrdiff_t stride, int h, int x, int y);
+
+    for (op = 0; op < 2; op++) {
+        const char *op_name = op ? "avg" : "put";
+
+        for (bit_depth = 8; bit_depth <= 10; bit_depth++) {
+            h264_chroma_mc_func *tab;
+
+            ff_h264chroma_init(&h, bit_depth);
+            tab = op ? h.avg_h264_chroma_pixels_tab : h.put_h264_chroma_pixels_tab;
+            for (i = 0; i < 4; i++) {
+                int size = 8 >> i;
+                if (check_func(tab[i], "%s_h264_chroma_mc%d_%d", op_name, size, bit_depth)) {
+                    for (j = 0; j < 16; j++) {
+                        /* heights of the chroma blocks of the partitions, up
+                         * to 4:2:2 macroblocks */
+                        int height = FFMAX(size, 2) << (rnd() % 3) >> (size > 2);
+                        int x = rnd() % 8, y = rnd() % 8;
+
+                        randomize_buffers();
+                        call_ref(dst0, src, STRIDE, height, x, y);
+                        call_new(dst1, src, STRIDE, height, x, y);
+                        if (memcmp(dst0, dst1, BUF_SIZE))
+                            fail();
+                    }
+                    bench_new(dst1, src, STRIDE, size, 3, 5);
+                }
+            }
+        }
+        report("%s", op_name);
+    }
+}
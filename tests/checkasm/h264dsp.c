@@ -312,9 +312,237 @@ static void check_idct_multiple(void)
     }
 }
 
+static void check_weight(void)
+{
+    LOCAL_ALIGNED_16(uint8_t, src,  [16 * 16 * 2]);
+    LOCAL_ALIGNED_16(uint8_t, dst0, [16 * 16 * 2]);
+    LOCAL_ALIGNED_16(uint8_t, dst1, [16 * 16 * 2]);
+    H264DSPContext h;
+    int bit_depth, i, j, k;
+
+    for (bit_depth = 8; bit_depth <= 10; bit_depth++) {
+        ptrdiff_t stride = 16 * SIZEOF_PIXEL;
+        uint32_t mask = pixel_mask[bit_depth - 8];
+
+        ff_h264dsp_init(&h, bit_depth, 1);
+        for (i = 0; i < 4; i++) {
+            int width = 16 >> i;
+            {
+                declare_func_emms(AV_CPU_FLAG_MMX, void, uint8_t *block, ptrdiff_t stride,
+                                  int height, int log2_denom, int weight, int offset);
+
+                if (check_func(h.weight_h264_pixels_tab[i], "h264_weight_%d_%dbpp", width, bit_depth)) {
+                    for (j = 0; j < 16; j++) {
+                        int height     = j & 1 ? width : FFMAX(width / 2, 2);
+                        int log2_denom = rnd() % 8;
+                        int weight     = rnd() % 256 - 128;
+                        int offset     = rnd() % 256 - 128;
+
+                        for (k = 0; k < 16 * 16 * 2; k += 4) {
+                            uint32_t r = rnd() & mask;
+                            AV_WN32A(dst0 + k, r);
+                            AV_WN32A(dst1 + k, r);
+                        }
+                        call_ref(dst0, stride, height, log2_denom, weight, offset);
+                        call_new(dst1, stride, height, log2_denom, weight, offset);
+                        if (memcmp(dst0, dst1, 16 * 16 * 2))
+                            fail();
+                    }
+                    bench_new(dst1, stride, width, 5, 48, 10);
+                }
+            }
+            {
+                declare_func_emms(AV_CPU_FLAG_MMX, void, uint8_t *dst, uint8_t *src,
+                                  ptrdiff_t stride, int height, int log2_denom,
+                                  int weightd, int weights, int offset);
+
+                if (check_func(h.biweight_h264_pixels_tab[i], "h264_biweight_%d_%dbpp", width, bit_depth)) {
+                    for (j = 0; j < 16; j++) {
+                        int height = j & 1 ? width : FFMAX(width / 2, 2);
+                        int log2_denom, weightd, weights, offset;
+
+                        if (j & 2) {
+                            /* implicit weights */
+                            log2_denom = 5;
+                            weights    = rnd() % 193 - 64;
+                            weightd    = 64 - weights;
+                            offset     = 0;
+                        } else {
+                            /* explicit weights, the sum of which is restricted
+                             * by the specification */
+                            log2_denom = rnd() % 8;
+                            do {
+                                weightd = rnd() % 256 - 128;
+                                weights = rnd() % 256 - 128;
+                            } while (weightd + weights < -128 ||
+                                     weightd + weights > (log2_denom == 7 ? 127 : 128));
+                            offset = rnd() % 256 - 128 + rnd() % 256 - 128;
+                        }
+
+                        for (k = 0; k < 16 * 16 * 2; k += 4) {
+                            uint32_t r = rnd() & mask;
+                            AV_WN32A(src + k, rnd() & mask);
+                            AV_WN32A(dst0 + k, r);
+                            AV_WN32A(dst1 + k, r);
+                        }
+                        call_ref(dst0, src, stride, height, log2_denom, weightd, weights, offset);
+                        call_new(dst1, src, stride, height, log2_denom, weightd, weights, offset);
+                        if (memcmp(dst0, dst1, 16 * 16 * 2))
+                            fail();
+                    }
+                    bench_new(dst1, src, stride, width, 5, 32, 32, 0);
+                }
+            }
+        }
+    }
+}
+
+#define LF_SIZE   32
+#define LF_STRIDE (LF_SIZE * SIZEOF_PIXEL)
+
+/* Fill a LF_SIZE x LF_SIZE block with noise around a random level, with a
+ * step across the edge at the center, so that all the filter paths are
+ * taken. */
+static void randomize_loop_filter_buffers(uint8_t *buf0, uint8_t *buf1,
+                                          int bit_depth, int horizontal)
+{
+    int max   = (1 << bit_depth) - 1;
+    int base  = rnd() & max;
+    int range = (rnd() % 3 ? 4 : 48) << (bit_depth - 8);
+    int step  = (rnd() % 17 - 8) << (bit_depth - 8);
+    int x, y;
+
+    for (y = 0; y < LF_SIZE; y++) {
+        for (x = 0; x < LF_SIZE; x++) {
+            int v = base + rnd() % (2 * range + 1) - range;
+            if ((horizontal ? x : y) >= LF_SIZE / 2)
+                v += step;
+            v = av_clip(v, 0, max);
+            if (bit_depth == 8) {
+                buf0[y * LF_SIZE + x] = buf1[y * LF_SIZE + x] = v;
+            } else {
+                AV_WN16A(buf0 + (y * LF_SIZE + x) * 2, v);
+                AV_WN16A(buf1 + (y * LF_SIZE + x) * 2, v);
+            }
+        }
+    }
+}
+
+static void check_loop_filter(void)
+{
+    LOCAL_ALIGNED_16(uint8_t, buf0, [LF_SIZE * LF_SIZE * 2]);
+    LOCAL_ALIGNED_16(uint8_t, buf1, [LF_SIZE * LF_SIZE * 2]);
+    H264DSPContext h;
+    int bit_depth, chroma_format_idc, func, i, j;
+    declare_func_emms(AV_CPU_FLAG_MMX, void, uint8_t *pix, int stride,
+                      int alpha, int beta, int8_t *tc0);
+
+    for (bit_depth = 8; bit_depth <= 10; bit_depth++) {
+        int offset = (LF_SIZE / 2 * LF_SIZE + LF_SIZE / 2) * SIZEOF_PIXEL;
+        for (chroma_format_idc = 1; chroma_format_idc <= 2; chroma_format_idc++) {
+            ff_h264dsp_init(&h, bit_depth, chroma_format_idc);
+            for (func = 0; func < 6; func++) {
+                void (*lf)(uint8_t *, int, int, int, int8_t *) = NULL;
+                const char *name;
+                int horizontal = 1, luma = 0;
+                switch (func) {
+                case 0: lf = h.h264_v_loop_filter_luma;         name = "v_luma";         horizontal = 0; luma = 1; break;
+                case 1: lf = h.h264_h_loop_filter_luma;         name = "h_luma";                         luma = 1; break;
+                case 2: lf = h.h264_h_loop_filter_luma_mbaff;   name = "h_luma_mbaff";                   luma = 1; break;
+                case 3: lf = h.h264_v_loop_filter_chroma;       name = "v_chroma";       horizontal = 0;           break;
+                case 4: lf = h.h264_h_loop_filter_chroma;       name = "h_chroma";                                 break;
+                case 5: lf = h.h264_h_loop_filter_chroma_mbaff; name = "h_chroma_mbaff";                           break;
+                }
+                /* only the chroma functions depend on the chroma format */
+                if (luma && chroma_format_idc > 1)
+                    continue;
+                if (check_func(lf, "h264_%s%s_%dbpp", name,
+                               horizontal && !luma && chroma_format_idc == 2 ? "422" : "",
+                               bit_depth)) {
+                    for (i = 0; i < 32; i++) {
+                        /* The decoder passes alpha, beta and tc0 from its 8-bit
+                         * tables at all bit depths; the functions scale them by
+                         * bit_depth - 8 themselves. */
+                        int alpha = rnd() % 255 + 1;
+                        int beta  = rnd() % 18 + 1;
+                        int8_t tc0[4];
+                        for (j = 0; j < 4; j++)
+                            tc0[j] = rnd() % 27 - 1;
+                        randomize_loop_filter_buffers(buf0, buf1, bit_depth, horizontal);
+                        call_ref(buf0 + offset, LF_STRIDE, alpha, beta, tc0);
+                        call_new(buf1 + offset, LF_STRIDE, alpha, beta, tc0);
+                        if (memcmp(buf0, buf1, LF_SIZE * LF_SIZE * SIZEOF_PIXEL))
+                            fail();
+                    }
+                    {
+                        int8_t tc0[4] = { 4, 8, 12, 16 };
+                        bench_new(buf1 + offset, LF_STRIDE, 40, 10, tc0);
+                    }
+                }
+            }
+        }
+    }
+}
+
+static void check_loop_filter_intra(void)
+{
+    LOCAL_ALIGNED_16(uint8_t, buf0, [LF_SIZE * LF_SIZE * 2]);
+    LOCAL_ALIGNED_16(uint8_t, buf1, [LF_SIZE * LF_SIZE * 2]);
+    H264DSPContext h;
+    int bit_depth, chroma_format_idc, func, i;
+    declare_func_emms(AV_CPU_FLAG_MMX, void, uint8_t *pix, int stride,
+                      int alpha, int beta);
+
+    for (bit_depth = 8; bit_depth <= 10; bit_depth++) {
+        int offset = (LF_SIZE / 2 * LF_SIZE + LF_SIZE / 2) * SIZEOF_PIXEL;
+        for (chroma_format_idc = 1; chroma_format_idc <= 2; chroma_format_idc++) {
+            ff_h264dsp_init(&h, bit_depth, chroma_format_idc);
+            for (func = 0; func < 6; func++) {
+                void (*lf)(uint8_t *, int, int, int) = NULL;
+                const char *name;
+                int horizontal = 1, luma = 0;
+                switch (func) {
+                case 0: lf = h.h264_v_loop_filter_luma_intra;         name = "v_luma_intra";         horizontal = 0; luma = 1; break;
+                case 1: lf = h.h264_h_loop_filter_luma_intra;         name = "h_luma_intra";                         luma = 1; break;
+                case 2: lf = h.h264_h_loop_filter_luma_mbaff_intra;   name = "h_luma_mbaff_intra";                   luma = 1; break;
+                case 3: lf = h.h264_v_loop_filter_chroma_intra;       name = "v_chroma_intra";       horizontal = 0;           break;
+                case 4: lf = h.h264_h_loop_filter_chroma_intra;       name = "h_chroma_intra";                                 break;
+                case 5: lf = h.h264_h_loop_filter_chroma_mbaff_intra; name = "h_chroma_mbaff_intra";                           break;
+                }
+                if (luma && chroma_format_idc > 1)
+                    continue;
+                if (check_func(lf, "h264_%s%s_%dbpp", name,
+                               horizontal && !luma && chroma_format_idc == 2 ? "422" : "",
+                               bit_depth)) {
+                    for (i = 0; i < 32; i++) {
+                        /* unscaled, as in check_loop_filter() */
+                        int alpha = rnd() % 255 + 1;
+                        int beta  = rnd() % 18 + 1;
+                        randomize_loop_filter_buffers(buf0, buf1, bit_depth, horizontal);
+                        call_ref(buf0 + offset, LF_STRIDE, alpha, beta);
+                        call_new(buf1 + offset, LF_STRIDE, alpha, beta);
+                        if (memcmp(buf0, buf1, LF_SIZE * LF_SIZE * SIZEOF_PIXEL))
+                            fail();
+                    }
+                    bench_new(buf1 + offset, LF_STRIDE, 40, 10);
+                }
+            }
+        }
+    }
+}
+
 void checkasm_check_h264dsp(void)
 {
     check_idct();
     check_idct_multiple();
     report("idct");
+
+    check_weight();
+    report("weight");
+
+    check_loop_filter();
+    report("loop_filter");
+
+    check_loop_filter_intra();
+    report("loop_filter_intra");
 }
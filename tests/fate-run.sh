@@ -92,6 +92,33 @@ probetags(){
     run ffprobe${PROGSUF} -show_entries format_tags -v 0 "$@"
 }
 
+probecache(){
+    srcfile="$1"
+    shift
+    name="${test}=a\\b'c.nut"
+    cache="${outdir}/${test}.cache"
+    tfile="$(target_path $outdir)/$name"
+    tcache=$(target_path $cache)
+    rm -rf "$cache" && mkdir "$cache" && cp "$srcfile" "$outdir/$name" || return
+    run ffprobe${PROGSUF} -bitexact -v debug "$tfile" 2>&1 >/dev/null | grep "Stream #"
+    run ffprobe${PROGSUF} -bitexact -probe_cache $tcache -v 0 "$@" "$tfile" || return
+    run ffprobe${PROGSUF} -bitexact -probe_cache $tcache -v verbose "$@" "$tfile" 2>&1 >/dev/null | grep -c "Using the probe cache entry"
+    run ffprobe${PROGSUF} -bitexact -probe_cache $tcache -v 0 "$@" "$tfile"
+    run ffprobe${PROGSUF} -bitexact -probe_cache $tcache -v debug "$tfile" 2>&1 >/dev/null | grep "Stream #"
+    rm -rf "$cache" "$outdir/$name"
+}
+
+probeanalyze(){
+    srcfile="$1"
+    entries="$2"
+    shift 2
+    serial="${outdir}/${test}.serial"
+    cleanfiles="$cleanfiles $serial"
+    run ffprobe${PROGSUF} -bitexact -show_entries "$entries" -of compact -v 0 "$srcfile" > "$serial" || return
+    run ffprobe${PROGSUF} -bitexact -show_entries "$entries" -of compact -v 0 "$@" "$srcfile" | diff -u "$serial" - || return
+    cat "$serial"
+}
+
 runlocal(){
     test "${V:-0}" -gt 0 && echo ${base}/"$@" ${base} >&3
     ${base}/"$@" ${base}
@@ -29,6 +29,31 @@ FATE_FFPROBE-$(CONFIG_AVDEVICE) += fate-ffprobe_xml
 fate-ffprobe_xml: $(FFPROBE_TEST_FILE)
 fate-ffprobe_xml: CMD = run $(FFPROBE_COMMAND) -of xml
 
+FATE_FFPROBE-$(CONFIG_AVDEVICE) += fate-ffprobe_probe_cache
+fate-ffprobe_probe_cache: $(FFPROBE_TEST_FILE)
+fate-ffprobe_probe_cache: CMD = probecache $(FFPROBE_TEST_FILE) -show_entries format=format_name,nb_streams,duration:stream=index,codec_name,time_base,r_frame_rate,width,sample_rate -of compact
+
+# avformat_find_stream_info() with parallel decoding and in fast mode must
+# find the same stream parameters as the serial analysis. The fast mode
+# does not measure the average frame rate.
+FFPROBE_ANALYZE_ENTRIES = stream=index,codec_type,codec_name,profile,width,height,has_b_frames,pix_fmt,sample_fmt,sample_rate,channels,channel_layout,r_frame_rate,time_base,start_pts
+
+FATE_FFPROBE-$(CONFIG_AVDEVICE) += fate-ffprobe_analyze_threads
+fate-ffprobe_analyze_threads: $(FFPROBE_TEST_FILE)
+fate-ffprobe_analyze_threads: CMD = probeanalyze $(FFPROBE_TEST_FILE) $(FFPROBE_ANALYZE_ENTRIES),avg_frame_rate -analyze_threads 2
+
+FATE_FFPROBE-$(CONFIG_AVDEVICE) += fate-ffprobe_fastinfo
+fate-ffprobe_fastinfo: $(FFPROBE_TEST_FILE)
+fate-ffprobe_fastinfo: CMD = probeanalyze $(FFPROBE_TEST_FILE) $(FFPROBE_ANALYZE_ENTRIES) -fflags fastinfo
+
+FATE_FFPROBE-$(call ENCDEC2, MPEG2VIDEO, MP2, MPEGTS) += fate-ffprobe_analyze_threads_ts
+fate-ffprobe_analyze_threads_ts: fate-lavf-ts
+fate-ffprobe_analyze_threads_ts: CMD = probeanalyze $(TARGET_PATH)/tests/data/lavf/lavf.ts $(FFPROBE_ANALYZE_ENTRIES),avg_frame_rate -analyze_threads 2
+
+FATE_FFPROBE-$(call ENCDEC2, MPEG2VIDEO, MP2, MPEGTS) += fate-ffprobe_fastinfo_ts
+fate-ffprobe_fastinfo_ts: fate-lavf-ts
+fate-ffprobe_fastinfo_ts: CMD = probeanalyze $(TARGET_PATH)/tests/data/lavf/lavf.ts $(FFPROBE_ANALYZE_ENTRIES) -fflags fastinfo
+
 FATE_FFPROBE += $(FATE_FFPROBE-yes)
 
 fate-ffprobe: $(FATE_FFPROBE)
@@ -15,5 +15,14 @@ FATE_MPEG4-$(call DEMDEC, M4V, MPEG4) += fate-m4v  fate-m4v-cfr
 fate-m4v:     CMD = framecrc -flags +bitexact -idct simple -i $(TARGET_SAMPLES)/mpeg4/demo.m4v
 fate-m4v-cfr: CMD = framecrc -flags +bitexact -idct simple -i $(TARGET_SAMPLES)/mpeg4/demo.m4v -vf fps=5
 
+# frame threading with a bounded output delay must return the same frames
+# as with the default delay (0)
+FATE_MPEG4_THREAD_MAX_DELAY = fate-mpeg4-thread-max-delay-0 fate-mpeg4-thread-max-delay-1 fate-mpeg4-thread-max-delay-3
+FATE_MPEG4_THREAD_MAX_DELAY-$(call ENCDEC, MPEG4, AVI) += $(FATE_MPEG4_THREAD_MAX_DELAY)
+$(FATE_MPEG4_THREAD_MAX_DELAY): fate-vsynth1-mpeg4-qprd
+$(FATE_MPEG4_THREAD_MAX_DELAY): REF = $(SRC_PATH)/tests/ref/fate/mpeg4-thread-max-delay
+fate-mpeg4-thread-max-delay-%: CMD = framecrc -flags +bitexact -idct simple -threads 4 -thread_type frame -thread_max_delay $(@:fate-mpeg4-thread-max-delay-%=%) -i $(TARGET_PATH)/tests/data/fate/vsynth1-mpeg4-qprd.avi
+
+FATE_AVCONV += $(FATE_MPEG4_THREAD_MAX_DELAY-yes)
 FATE_SAMPLES_AVCONV += $(FATE_MPEG4-yes)
-fate-mpeg4: $(FATE_MPEG4-yes)
+fate-mpeg4: $(FATE_MPEG4-yes) $(FATE_MPEG4_THREAD_MAX_DELAY-yes)
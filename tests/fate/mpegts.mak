@@ -23,3 +23,23 @@ fate-mpegts-probe-pmt-merge: CMD = run $(PROBE_CODEC_NAME_COMMAND) -merge_pmt_ve
 FATE_SAMPLES_FFPROBE += $(FATE_MPEGTS_PROBE-yes)
 
 fate-mpegts: $(FATE_MPEGTS_PROBE-yes)
+
+tests/data/mpegts-discard.ts: TAG = GEN
+tests/data/mpegts-discard.ts: ffmpeg$(PROGSSUF)$(EXESUF) | tests/data
+	$(M)$(TARGET_EXEC) $(TARGET_PATH)/$< \
+        -f lavfi -i "testsrc=d=1:s=160x120[out0]; sine=d=1[out1]; testsrc=d=1:s=64x64[out2]" \
+        -map 0:0 -map 0:1 -map 0:2 -c:v mpeg2video -c:a mp2 \
+        -program title=first:st=0:st=1 -program title=second:st=2 \
+        -flags +bitexact -fflags +bitexact -y $(TARGET_PATH)/$@ 2>/dev/null
+
+# the PCR of the first program is carried by its video PID, which is discarded
+FATE_MPEGTS_DISCARD-$(call ALLYES, LAVFI_INDEV TESTSRC_FILTER SINE_FILTER MPEG2VIDEO_ENCODER MP2_ENCODER MPEGTS_MUXER MPEGTS_DEMUXER) += fate-mpegts-discard-streams
+fate-mpegts-discard-streams: tests/data/mpegts-discard.ts
+fate-mpegts-discard-streams: CMD = framecrc -discard:v:0 all -i $(TARGET_PATH)/tests/data/mpegts-discard.ts -map 0:a -map 0:v:1 -c copy
+
+FATE_MPEGTS_DISCARD-$(call ALLYES, LAVFI_INDEV TESTSRC_FILTER SINE_FILTER MPEG2VIDEO_ENCODER MP2_ENCODER MPEGTS_MUXER MPEGTS_DEMUXER) += fate-mpegts-discard-program
+fate-mpegts-discard-program: tests/data/mpegts-discard.ts
+fate-mpegts-discard-program: CMD = framecrc -i $(TARGET_PATH)/tests/data/mpegts-discard.ts -map 0:p:2 -c copy
+
+FATE_FFMPEG += $(FATE_MPEGTS_DISCARD-yes)
+fate-mpegts: $(FATE_MPEGTS_DISCARD-yes)
@@ -265,12 +265,34 @@ fate-seek-mkv-codec-delay:   CMD = run libavformat/tests/seek$(EXESUF) $(TARGET_
 
 FATE_SEEK_EXTRA += $(FATE_SEEK_EXTRA-yes)
 
+# the seeks of lavf-mov over the compact index of the mov demuxer
+FATE_SEEK_COMPACT-$(call ENCDEC2, MPEG4, PCM_ALAW, MOV) += fate-seek-lavf-mov-compact-index
+fate-seek-lavf-mov-compact-index: fate-lavf-mov libavformat/tests/seek$(EXESUF)
+fate-seek-lavf-mov-compact-index: CMD = run libavformat/tests/seek$(EXESUF) $(TARGET_PATH)/tests/data/lavf/lavf.mov -compact_index 1
+
+FATE_SEEK_COMPACT += $(FATE_SEEK_COMPACT-yes)
+
+# the seeks in a fragmented mp4 with an mfra, with and without lazy fragment loading
+tests/data/frag-mfra.mp4: TAG = GEN
+tests/data/frag-mfra.mp4: ffmpeg$(PROGSSUF)$(EXESUF) | tests/data
+	$(M)$(TARGET_EXEC) $(TARGET_PATH)/$< -nostdin \
+		-f lavfi -i "testsrc=d=4:s=64x64:r=25" -f lavfi -i "sine=d=4:r=8000" \
+		-c:v mpeg4 -g 12 -c:a mp2 -fflags +bitexact -flags +bitexact \
+		-movflags frag_keyframe -y $(TARGET_PATH)/$@ 2>/dev/null
+
+FATE_SEEK_FRAGMENTS-$(call ALLYES, LAVFI_INDEV TESTSRC_FILTER SINE_FILTER MPEG4_ENCODER MP2_ENCODER MP4_MUXER MOV_DEMUXER) += fate-seek-frag-mfra-mp4 fate-seek-frag-mfra-lazy-mp4
+fate-seek-frag-mfra-mp4 fate-seek-frag-mfra-lazy-mp4: tests/data/frag-mfra.mp4 libavformat/tests/seek$(EXESUF)
+fate-seek-frag-mfra-mp4: CMD = run libavformat/tests/seek$(EXESUF) $(TARGET_PATH)/tests/data/frag-mfra.mp4
+fate-seek-frag-mfra-lazy-mp4: CMD = run libavformat/tests/seek$(EXESUF) $(TARGET_PATH)/tests/data/frag-mfra.mp4 -lazy_fragments 1
+
+FATE_SEEK_FRAGMENTS += $(FATE_SEEK_FRAGMENTS-yes)
+
 
 $(FATE_SEEK) $(FATE_SAMPLES_SEEK) $(FATE_SEEK_EXTRA): libavformat/tests/seek$(EXESUF)
 $(FATE_SEEK) $(FATE_SAMPLES_SEEK): CMD = run libavformat/tests/seek$(EXESUF) $(TARGET_PATH)/tests/data/$(SRC)
 $(FATE_SEEK) $(FATE_SAMPLES_SEEK): fate-seek-%: fate-%
 fate-seek-%: REF = $(SRC_PATH)/tests/ref/seek/$(@:fate-seek-%=%)
 
-FATE_AVCONV += $(FATE_SEEK)
+FATE_AVCONV += $(FATE_SEEK) $(FATE_SEEK_COMPACT) $(FATE_SEEK_FRAGMENTS)
 FATE_SAMPLES_AVCONV += $(FATE_SAMPLES_SEEK) $(FATE_SEEK_EXTRA)
-fate-seek:     $(FATE_SEEK) $(FATE_SAMPLES_SEEK) $(FATE_SEEK_EXTRA)
+fate-seek:     $(FATE_SEEK) $(FATE_SEEK_COMPACT) $(FATE_SEEK_FRAGMENTS) $(FATE_SAMPLES_SEEK) $(FATE_SEEK_EXTRA)
@@ -0,0 +1,111 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with FFmpeg; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/*
+ * Remux a file like ffmpeg -c copy and report how many bytes were copied
+ * between the I/O buffers and the packets, per input byte.
+ *
+ * The counts are the bytes_copied statistics of the input and output
+ * AVIOContexts. Copies made by the demuxers and muxers themselves, like the
+ * PES assembly of the MPEG-TS demuxer, are not included.
+ */
+
+#include <stdio.h>
+
+#include "libavformat/avformat.h"
+#include "libavutil/time.h"
+
+int main(int argc, char **argv)
+{
+    AVFormatContext *ifmt = NULL, *ofmt = NULL;
+    AVPacket pkt;
+    int64_t in_bytes, in_copied, out_bytes, out_copied, t0, t1;
+    int i, ret;
+
+    if (argc < 3) {
+        fprintf(stderr, "usage: %s input output [format]\n"
+                "Remux input to output and report the bytes copied by libavformat.\n",
+                argv[0]);
+        return 1;
+    }
+
+    if ((ret = avformat_open_input(&ifmt, argv[1], NULL, NULL)) < 0 ||
+        (ret = avformat_find_stream_info(ifmt, NULL)) < 0)
+        goto end;
+
+    if ((ret = avformat_alloc_output_context2(&ofmt, NULL,
+                                              argc > 3 ? argv[3] : NULL,
+                                              argv[2])) < 0)
+        goto end;
+    for (i = 0; i < ifmt->nb_streams; i++) {
+        AVStream *ost = avformat_new_stream(ofmt, NULL);
+        if (!ost) {
+            ret = AVERROR(ENOMEM);
+            goto end;
+        }
+        if ((ret = avcodec_parameters_copy(ost->codecpar,
+                                           ifmt->streams[i]->codecpar)) < 0)
+            goto end;
+        ost->codecpar->codec_tag = 0;
+        ost->time_base = ifmt->streams[i]->time_base;
+    }
+    if (!(ofmt->oformat->flags & AVFMT_NOFILE) &&
+        (ret = avio_open(&ofmt->pb, argv[2], AVIO_FLAG_WRITE)) < 0)
+        goto end;
+    if ((ret = avformat_write_header(ofmt, NULL)) < 0)
+        goto end;
+
+    t0 = av_gettime_relative();
+    while ((ret = av_read_frame(ifmt, &pkt)) >= 0) {
+        AVStream *ist = ifmt->streams[pkt.stream_index];
+        AVStream *ost = ofmt->streams[pkt.stream_index];
+
+        av_packet_rescale_ts(&pkt, ist->time_base, ost->time_base);
+        pkt.pos = -1;
+        if ((ret = av_interleaved_write_frame(ofmt, &pkt)) < 0)
+            goto end;
+    }
+    if ((ret = av_write_trailer(ofmt)) < 0)
+        goto end;
+    t1 = av_gettime_relative();
+
+    in_bytes   = avio_tell(ifmt->pb);
+    in_copied  = ifmt->pb->bytes_copied;
+    avio_flush(ofmt->pb);
+    out_bytes  = avio_tell(ofmt->pb);
+    out_copied = ofmt->pb->bytes_copied;
+
+    printf("input:  %"PRId64" bytes read, %"PRId64" bytes copied\n",
+           in_bytes, in_copied);
+    printf("output: %"PRId64" bytes written, %"PRId64" bytes copied\n",
+           out_bytes, out_copied);
+    printf("bytes copied per input byte: %.3f\n",
+           in_bytes ? (double)(in_copied + out_copied) / in_bytes : 0.0);
+    printf("remux time: %.3f s, %.1f MB/s\n", (t1 - t0) / 1000000.0,
+           t1 > t0 ? in_bytes / (double)(t1 - t0) : 0.0);
+    ret = 0;
+
+end:
+    if (ret < 0)
+        fprintf(stderr, "Error: %s\n", av_err2str(ret));
+    avformat_close_input(&ifmt);
+    if (ofmt && !(ofmt->oformat->flags & AVFMT_NOFILE))
+        avio_closep(&ofmt->pb);
+    avformat_free_context(ofmt);
+    return ret < 0;
+}